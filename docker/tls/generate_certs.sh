@@ -0,0 +1,28 @@
+#!/bin/sh
+# Erzeugt eine Test-CA und ein Serverzertifikat für den lokalen TLS-Broker.
+# Nur für Tests im lokalen Netz, nicht für den Produktivbetrieb!
+# Aufruf: ./generate_certs.sh <Broker-IP>   (z.B. ./generate_certs.sh 192.168.178.20)
+set -e
+
+IP="${1:?Bitte die IP des Docker-Hosts angeben}"
+DIR="$(cd "$(dirname "$0")" && pwd)/certs"
+mkdir -p "$DIR"
+
+# CA (ECDSA P-256: deutlich schnellerer Handshake auf dem ESP32 als RSA)
+openssl req -x509 -newkey ec -pkeyopt ec_paramgen_curve:prime256v1 -nodes -days 825 \
+  -subj "/CN=ESP32 Test CA" -keyout "$DIR/ca.key" -out "$DIR/ca.crt"
+
+# Serverzertifikat für die Broker-IP.
+# mbedtls 2.x prüft nur DNS-Einträge im subjectAltName, daher steht die IP
+# zusätzlich als DNS-Name drin (ESP32 verbindet sich mit MQTT_BROKER_IP).
+openssl req -newkey ec -pkeyopt ec_paramgen_curve:prime256v1 -nodes \
+  -subj "/CN=$IP" -keyout "$DIR/server.key" -out "$DIR/server.csr"
+printf "subjectAltName=IP:%s,DNS:%s\n" "$IP" "$IP" > "$DIR/server.ext"
+openssl x509 -req -in "$DIR/server.csr" -CA "$DIR/ca.crt" -CAkey "$DIR/ca.key" -CAcreateserial \
+  -days 825 -extfile "$DIR/server.ext" -out "$DIR/server.crt"
+
+# Mosquitto läuft im Container unter einem eigenen Benutzer
+chmod 644 "$DIR/server.key"
+rm -f "$DIR/server.csr" "$DIR/server.ext"
+
+echo "Fertig. Inhalt von $DIR/ca.crt als MQTT_CA_CERT in esp32/src/secrets.h eintragen."
@@ -0,0 +1,149 @@
+#ifndef GPIO_GROUPS_H
+#define GPIO_GROUPS_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "littlefs_settings.h"
+
+// ----------------------------------------
+// Gruppen-Index für flottenweite GPIO-Befehle
+// Befehle auf esp32/all/gpio/set bzw. esp32/group/<gruppe>/gpio/set adressieren
+// Pins über gpioConfigs[].group oder .label statt über die Pin-Nummer.
+// Aus der Konfiguration wird ein Index (Gruppe -> Bitmaske der Pin-Indizes)
+// aufgebaut, so dass ein Befehl mit wenigen Vergleichen aufgelöst wird und
+// Geräte ohne passende Pins die Nachricht sofort verwerfen.
+// ----------------------------------------
+
+#define GPIO_ALL_SET_TOPIC "esp32/all/gpio/set"
+#define GPIO_GROUP_TOPIC_PREFIX "esp32/group/"
+#define GPIO_GROUP_TOPIC_SUFFIX "/gpio/set"
+#define GPIO_GROUP_TOPIC_MAX_LEN 64
+#define GPIO_INDEX_MAX_GROUPS 8
+
+// Externe Referenzen: werden in main.cpp definiert
+extern int control_pins[];
+
+struct GpioGroupEntry {
+  char name[GPIO_GROUP_MAX_LEN];
+  uint32_t pinMask = 0;                    // Bit i = control_pins[i] gehört zur Gruppe
+  char topic[GPIO_GROUP_TOPIC_MAX_LEN];    // Leer, wenn der Name nicht als Topic-Ebene taugt
+};
+
+struct GpioIndex {
+  int groupCount = 0;
+  GpioGroupEntry groups[GPIO_INDEX_MAX_GROUPS];
+};
+
+GpioIndex gpioIndex;
+
+// Gruppennamen mit '/', '+' oder '#' würden das Topic verfälschen
+bool isValidTopicLevel(const char* name) {
+  if (name[0] == '\0') return false;
+  return strpbrk(name, "/+#") == nullptr;
+}
+
+// ----------------------------------------
+// Funktion: rebuildGpioIndex
+// Baut den Index aus gpioConfigs neu auf (beim Start und nach settings/set).
+// Die Gruppe "none" wird nicht indiziert.
+// ----------------------------------------
+void rebuildGpioIndex() {
+  gpioIndex.groupCount = 0;
+
+  for (int i = 0; i < NUM_PINS; i++) {
+    const char* group = gpioConfigs[i].group;
+    if (group[0] == '\0' || strcmp(group, "none") == 0) continue;
+
+    GpioGroupEntry* entry = nullptr;
+    for (int g = 0; g < gpioIndex.groupCount; g++) {
+      if (strcmp(gpioIndex.groups[g].name, group) == 0) {
+        entry = &gpioIndex.groups[g];
+        break;
+      }
+    }
+
+    if (entry == nullptr) {
+      if (gpioIndex.groupCount >= GPIO_INDEX_MAX_GROUPS) continue;
+      entry = &gpioIndex.groups[gpioIndex.groupCount++];
+      strlcpy(entry->name, group, sizeof(entry->name));
+      entry->pinMask = 0;
+      entry->topic[0] = '\0';
+      if (isValidTopicLevel(group)) {
+        snprintf(entry->topic, sizeof(entry->topic), "%s%s%s",
+                 GPIO_GROUP_TOPIC_PREFIX, group, GPIO_GROUP_TOPIC_SUFFIX);
+      }
+    }
+    entry->pinMask |= 1UL << i;
+  }
+}
+
+uint32_t gpioMaskForGroup(const char* group) {
+  for (int g = 0; g < gpioIndex.groupCount; g++) {
+    if (strcmp(gpioIndex.groups[g].name, group) == 0) return gpioIndex.groups[g].pinMask;
+  }
+  return 0;
+}
+
+uint32_t gpioMaskForLabel(const char* label) {
+  uint32_t mask = 0;
+  for (int i = 0; i < NUM_PINS; i++) {
+    if (strcmp(gpioConfigs[i].label, label) == 0) mask |= 1UL << i;
+  }
+  return mask;
+}
+
+uint32_t gpioMaskForPin(int pinNumber) {
+  for (int i = 0; i < NUM_PINS; i++) {
+    if (control_pins[i] == pinNumber) return 1UL << i;
+  }
+  return 0;
+}
+
+// Liefert die Gruppe zu einem abonnierten Gruppen-Topic (oder nullptr)
+const char* gpioGroupForTopic(const char* topic) {
+  if (strncmp(topic, GPIO_GROUP_TOPIC_PREFIX, sizeof(GPIO_GROUP_TOPIC_PREFIX) - 1) != 0) return nullptr;
+  for (int g = 0; g < gpioIndex.groupCount; g++) {
+    if (strcmp(gpioIndex.groups[g].topic, topic) == 0) return gpioIndex.groups[g].name;
+  }
+  return nullptr;
+}
+
+// ----------------------------------------
+// Funktion: resolveGpioTargets
+// Ermittelt die Pin-Indizes (Bitmaske), die ein einzelnes Befehlsobjekt betrifft.
+// Selektoren: "pinNumber", "group", "label". Mehrere Selektoren werden UND-verknüpft.
+// impliedGroup (vom Gruppen-Topic) schränkt zusätzlich ein; ohne Selektor
+// und ohne impliedGroup wird nichts geschaltet. Ein vorhandenes "group" oder
+// "label", das kein nicht-leerer String ist, gilt als ungültig (-> 0): sonst
+// würde z.B. {"label": ""} alle Pins ohne Label auf allen Geräten treffen.
+// ----------------------------------------
+uint32_t resolveGpioTargets(JsonObject cmd, const char* impliedGroup) {
+  const uint32_t allPins = (1UL << NUM_PINS) - 1;
+  uint32_t mask = allPins;
+  bool selected = false;
+
+  if (impliedGroup != nullptr) {
+    mask &= gpioMaskForGroup(impliedGroup);
+    selected = true;
+  }
+  if (cmd["pinNumber"].is<int>()) {
+    mask &= gpioMaskForPin(cmd["pinNumber"].as<int>());
+    selected = true;
+  }
+  if (!cmd["group"].isNull()) {
+    const char* group = cmd["group"].as<const char*>();
+    if (group == nullptr || group[0] == '\0') return 0;
+    mask &= gpioMaskForGroup(group);
+    selected = true;
+  }
+  if (!cmd["label"].isNull()) {
+    const char* label = cmd["label"].as<const char*>();
+    if (label == nullptr || label[0] == '\0') return 0;
+    mask &= gpioMaskForLabel(label);
+    selected = true;
+  }
+
+  return selected ? mask : 0;
+}
+
+#endif // GPIO_GROUPS_H
@@ -0,0 +1,120 @@
+#ifndef HANDLER_PROFILE_H
+#define HANDLER_PROFILE_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <esp_heap_caps.h>
+#include "json_arena.h"
+#include "sample_window.h"
+
+// ----------------------------------------
+// Profil pro Nachrichtentyp: Laufzeit und Speicherverbrauch der Handler
+// Jede Nachricht im MQTT-Callback wird einer Kategorie zugeordnet. Pro
+// Kategorie werden Handler-Dauer, Arena-Spitze und Heap-Veränderung erfasst.
+// Grundlage für Regressionstests: Eine aufgezeichnete Last (traffic_capture.h)
+// wird erneut abgespielt und das Profil vor/nach einer Änderung verglichen.
+// ----------------------------------------
+
+#define PROFILE_WINDOW_SIZE 32
+
+enum HandlerCategory {
+  HANDLER_NONE = -1,        // Nicht profiliert (z.B. OTA-Chunks, eigene Veröffentlichungen)
+  HANDLER_GPIO_SET = 0,
+  HANDLER_STATUS_GET,
+  HANDLER_WIFI_GET,
+  HANDLER_GPIO_GET,
+  HANDLER_SETTINGS_GET,
+  HANDLER_SETTINGS_SET,
+  HANDLER_PING,
+  HANDLER_LATENCY_GET,
+  HANDLER_OTHER,
+  HANDLER_CATEGORY_COUNT
+};
+
+const char* const handlerCategoryNames[HANDLER_CATEGORY_COUNT] = {
+  "gpio_set", "status_get", "wifi_get", "gpio_get", "settings_get",
+  "settings_set", "ping", "latency_get", "other"
+};
+
+struct HandlerProfileEntry {
+  SampleWindow<uint32_t, PROFILE_WINDOW_SIZE> durationUs;   // Laufzeit des Handlers
+  SampleWindow<uint32_t, PROFILE_WINDOW_SIZE> arenaBytes;   // Arena-Spitze während des Handlers
+  uint32_t heapFallbacks = 0;    // Arena übergelaufen -> Allokation auf dem Heap
+  int32_t heapDelta = 0;         // Summe der Heap-Differenzen (vorher/nachher)
+};
+
+struct HandlerProfile {
+  HandlerProfileEntry entries[HANDLER_CATEGORY_COUNT];
+  uint32_t messages = 0;
+  uint32_t minFreeHeap = 0;      // Kleinster freier Heap nach einem Handler seit dem Reset
+  uint32_t resetAt = 0;          // millis() des letzten Resets
+
+  // Stand zu Beginn der aktuellen Nachricht
+  uint32_t startedAt = 0;        // micros()
+  uint32_t freeBefore = 0;
+  uint32_t fallbacksBefore = 0;
+};
+
+HandlerProfile handlerProfile;
+
+void resetHandlerProfile() {
+  for (int i = 0; i < HANDLER_CATEGORY_COUNT; i++) {
+    handlerProfile.entries[i].durationUs.clear();
+    handlerProfile.entries[i].arenaBytes.clear();
+    handlerProfile.entries[i].heapFallbacks = 0;
+    handlerProfile.entries[i].heapDelta = 0;
+  }
+  handlerProfile.messages = 0;
+  handlerProfile.minFreeHeap = 0;
+  handlerProfile.resetAt = millis();
+}
+
+// Vor dem Handler aufrufen
+void beginHandlerProfile() {
+  handlerProfile.freeBefore = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+  handlerProfile.fallbacksBefore = jsonArena.heapFallbacks();
+  jsonArena.markPeak();
+  handlerProfile.startedAt = micros();
+}
+
+// Nach dem Handler aufrufen
+void endHandlerProfile(HandlerCategory category) {
+  uint32_t duration = micros() - handlerProfile.startedAt;
+  uint32_t freeAfter = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+
+  HandlerProfileEntry& entry = handlerProfile.entries[category];
+  entry.durationUs.add(duration);
+  entry.arenaBytes.add(jsonArena.peakSinceMark());
+  entry.heapFallbacks += jsonArena.heapFallbacks() - handlerProfile.fallbacksBefore;
+  entry.heapDelta += (int32_t)(freeAfter - handlerProfile.freeBefore);
+
+  handlerProfile.messages++;
+  if (handlerProfile.minFreeHeap == 0 || freeAfter < handlerProfile.minFreeHeap) {
+    handlerProfile.minFreeHeap = freeAfter;
+  }
+}
+
+// ----------------------------------------
+// Funktion: handlerProfileToJson
+// Schreibt das Profil aller Kategorien mit mindestens einer Nachricht
+// ----------------------------------------
+void handlerProfileToJson(JsonObject obj) {
+  obj["messages"] = handlerProfile.messages;
+  obj["sinceMs"] = millis() - handlerProfile.resetAt;
+  obj["minFreeHeap"] = handlerProfile.minFreeHeap;
+  obj["largestBlock"] = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+
+  JsonObject handlers = obj["handlers"].to<JsonObject>();
+  for (int i = 0; i < HANDLER_CATEGORY_COUNT; i++) {
+    const HandlerProfileEntry& entry = handlerProfile.entries[i];
+    if (entry.durationUs.total == 0) continue;
+
+    JsonObject h = handlers[handlerCategoryNames[i]].to<JsonObject>();
+    entry.durationUs.summaryToJson(h["us"].to<JsonObject>());
+    h["arenaMax"] = entry.arenaBytes.maximum();
+    h["heapFallbacks"] = entry.heapFallbacks;
+    h["heapDelta"] = entry.heapDelta;
+  }
+}
+
+#endif // HANDLER_PROFILE_H
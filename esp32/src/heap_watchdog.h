@@ -0,0 +1,84 @@
+#ifndef HEAP_WATCHDOG_H
+#define HEAP_WATCHDOG_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <esp_heap_caps.h>
+#include "json_arena.h"
+
+// ----------------------------------------
+// Heap-/Fragmentierungs-Watchdog
+// Überwacht freien Heap und den größten zusammenhängenden freien Block.
+// Nach einer Einschwingphase wird ein Referenzwert festgehalten; sinkt der
+// freie Heap danach dauerhaft, deutet das auf Allokationen im Dauerbetrieb hin.
+// ----------------------------------------
+
+#define HEAP_LARGEST_BLOCK_WARN 16384  // Warnung, wenn der größte freie Block kleiner wird (Bytes)
+#define HEAP_SETTLE_SAMPLES 2          // Anzahl Messungen bis zur Referenz (Verbindungsaufbau abwarten)
+#define HEAP_DRIFT_TOLERANCE 1024      // Erlaubte Abweichung vom Referenzwert (Bytes)
+
+struct HeapWatchdog {
+  uint32_t freeHeap = 0;          // Aktuell freier Heap
+  uint32_t largestBlock = 0;      // Aktuell größter freier Block
+  uint32_t minLargestBlock = 0;   // Kleinster gemessener größter Block seit Boot
+  uint32_t baselineFree = 0;      // Referenzwert nach der Einschwingphase
+  uint32_t samples = 0;           // Anzahl Messungen
+  uint32_t driftEvents = 0;       // Messungen unterhalb Referenz - Toleranz
+  bool lowBlockWarning = false;   // Größter Block unter HEAP_LARGEST_BLOCK_WARN
+};
+
+HeapWatchdog heapWatchdog;
+
+// ----------------------------------------
+// Funktion: sampleHeap
+// Nimmt eine Messung auf (wird mit jedem Heartbeat aufgerufen)
+// ----------------------------------------
+void sampleHeap() {
+  heapWatchdog.freeHeap = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+  heapWatchdog.largestBlock = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+  heapWatchdog.samples++;
+
+  if (heapWatchdog.minLargestBlock == 0 || heapWatchdog.largestBlock < heapWatchdog.minLargestBlock) {
+    heapWatchdog.minLargestBlock = heapWatchdog.largestBlock;
+  }
+
+  // Referenz erst festhalten, wenn WLAN/MQTT ihre Puffer angelegt haben
+  if (heapWatchdog.samples == HEAP_SETTLE_SAMPLES) {
+    heapWatchdog.baselineFree = heapWatchdog.freeHeap;
+  } else if (heapWatchdog.samples > HEAP_SETTLE_SAMPLES &&
+             heapWatchdog.freeHeap + HEAP_DRIFT_TOLERANCE < heapWatchdog.baselineFree) {
+    heapWatchdog.driftEvents++;
+    Serial.print("WARNUNG: Freier Heap unter Referenzwert: ");
+    Serial.print(heapWatchdog.freeHeap);
+    Serial.print(" < ");
+    Serial.println(heapWatchdog.baselineFree);
+  }
+
+  heapWatchdog.lowBlockWarning = heapWatchdog.largestBlock < HEAP_LARGEST_BLOCK_WARN;
+  if (heapWatchdog.lowBlockWarning) {
+    Serial.print("WARNUNG: Größter freier Heap-Block nur noch ");
+    Serial.print(heapWatchdog.largestBlock);
+    Serial.println(" Bytes (Fragmentierung)");
+  }
+}
+
+// ----------------------------------------
+// Funktion: heapStatsToJson
+// Schreibt die Heap-Kennzahlen in ein JSON-Objekt (für den Heartbeat)
+// ----------------------------------------
+void heapStatsToJson(JsonObject obj) {
+  obj["free"] = heapWatchdog.freeHeap;
+  obj["minFree"] = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+  obj["largestBlock"] = heapWatchdog.largestBlock;
+  obj["minLargestBlock"] = heapWatchdog.minLargestBlock;
+  // Fragmentierung in Prozent: 0 = der gesamte freie Heap ist ein Block
+  obj["fragmentation"] = heapWatchdog.freeHeap == 0 ? 0 :
+    100 - (uint32_t)((uint64_t)heapWatchdog.largestBlock * 100 / heapWatchdog.freeHeap);
+  obj["baseline"] = heapWatchdog.baselineFree;
+  obj["driftEvents"] = heapWatchdog.driftEvents;
+  obj["lowBlock"] = heapWatchdog.lowBlockWarning;
+  obj["arenaPeak"] = jsonArena.peakUsed();
+  obj["arenaFallbacks"] = jsonArena.heapFallbacks();
+}
+
+#endif // HEAP_WATCHDOG_H
@@ -0,0 +1,149 @@
+#ifndef JSON_ARENA_H
+#define JSON_ARENA_H
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <cstdint>                  // Host-Build für die Unit-Tests (pio test -e native)
+#include <cstdlib>
+#include <cstring>
+#endif
+#include <ArduinoJson.h>
+
+// ----------------------------------------
+// Statische Speicherverwaltung für JSON-Dokumente
+// Alle JsonDocuments der Firmware holen ihren Speicher aus einer statischen
+// Arena statt vom Heap. Dadurch entstehen im Dauerbetrieb keine Heap-Allokationen
+// (und damit keine Fragmentierung) durch das Parsen/Erzeugen von Nachrichten.
+// ----------------------------------------
+
+#define JSON_ARENA_SIZE 16384       // Größe der Arena in Bytes (reicht für WiFi-Scan + verschachtelte Dokumente)
+#define MQTT_PAYLOAD_MAX_LEN 2048   // Entspricht client.setBufferSize(2048)
+
+// ----------------------------------------
+// Klasse: JsonArena
+// Bump-Allocator für ArduinoJson (v7 Allocator-Interface).
+// Blöcke werden nacheinander in einem festen Puffer vergeben. Sobald alle
+// Blöcke wieder freigegeben sind (alle Dokumente zerstört), wird die Arena
+// komplett zurückgesetzt. Reicht der Platz nicht, wird auf den Heap
+// ausgewichen und der Fall mitgezählt (sollte im Normalbetrieb 0 bleiben).
+// ----------------------------------------
+class JsonArena : public ArduinoJson::Allocator {
+public:
+  void* allocate(size_t size) override {
+    size_t total = HEADER_SIZE + alignSize(size);
+    if (used_ + total > JSON_ARENA_SIZE) {
+      heapFallbacks_++;
+      return malloc(size);
+    }
+
+    uint8_t* block = buffer_ + used_;
+    *(size_t*)block = size; // Header: angeforderte Größe
+    used_ += total;
+    liveBlocks_++;
+    if (used_ > peakUsed_) peakUsed_ = used_;
+    if (used_ > markPeak_) markPeak_ = used_;
+    return block + HEADER_SIZE;
+  }
+
+  void deallocate(void* ptr) override {
+    if (ptr == nullptr) return;
+    if (!owns(ptr)) {
+      free(ptr);
+      return;
+    }
+
+    // Oberster Block kann sofort zurückgegeben werden
+    uint8_t* block = (uint8_t*)ptr - HEADER_SIZE;
+    if (isTopBlock(block)) used_ = block - buffer_;
+
+    // Alle Blöcke frei -> Arena komplett zurücksetzen
+    if (--liveBlocks_ == 0) used_ = 0;
+  }
+
+  void* reallocate(void* ptr, size_t newSize) override {
+    if (ptr == nullptr) return allocate(newSize);
+    if (!owns(ptr)) return realloc(ptr, newSize);
+
+    uint8_t* block = (uint8_t*)ptr - HEADER_SIZE;
+    size_t oldSize = *(size_t*)block;
+
+    // Oberster Block: in-place vergrößern/verkleinern, wenn Platz ist
+    if (isTopBlock(block)) {
+      size_t offset = block - buffer_;
+      size_t total = HEADER_SIZE + alignSize(newSize);
+      if (offset + total <= JSON_ARENA_SIZE) {
+        *(size_t*)block = newSize;
+        used_ = offset + total;
+        if (used_ > peakUsed_) peakUsed_ = used_;
+        if (used_ > markPeak_) markPeak_ = used_;
+        return ptr;
+      }
+    }
+
+    // Sonst: neuen Block anlegen und Inhalt kopieren
+    void* newPtr = allocate(newSize);
+    if (newPtr == nullptr) return nullptr;
+    memcpy(newPtr, ptr, oldSize < newSize ? oldSize : newSize);
+    deallocate(ptr);
+    return newPtr;
+  }
+
+  size_t used() const { return used_; }
+  size_t peakUsed() const { return peakUsed_; }
+  uint32_t heapFallbacks() const { return heapFallbacks_; }
+
+  // Spitzenbelegung seit markPeak() (z.B. pro verarbeiteter Nachricht)
+  void markPeak() { markPeak_ = used_; }
+  size_t peakSinceMark() const { return markPeak_; }
+
+private:
+  static const size_t HEADER_SIZE = 8;
+
+  static size_t alignSize(size_t size) {
+    return (size + 7) & ~(size_t)7;
+  }
+
+  bool owns(void* ptr) const {
+    return (uint8_t*)ptr >= buffer_ && (uint8_t*)ptr < buffer_ + JSON_ARENA_SIZE;
+  }
+
+  bool isTopBlock(uint8_t* block) const {
+    return block + HEADER_SIZE + alignSize(*(size_t*)block) == buffer_ + used_;
+  }
+
+  alignas(8) uint8_t buffer_[JSON_ARENA_SIZE];
+  size_t used_ = 0;
+  size_t peakUsed_ = 0;
+  size_t markPeak_ = 0;
+  size_t liveBlocks_ = 0;
+  uint32_t heapFallbacks_ = 0;
+};
+
+// Globale Arena für alle JsonDocuments: JsonDocument doc(&jsonArena);
+JsonArena jsonArena;
+
+// Gemeinsamer Ausgabepuffer für serialisierte MQTT-Payloads.
+// Jede Sende-Funktion serialisiert hier hinein und veröffentlicht sofort.
+char mqttPayload[MQTT_PAYLOAD_MAX_LEN];
+
+// ----------------------------------------
+// Funktion: serializePayload
+// Serialisiert ein JSON-Dokument in mqttPayload.
+// Gibt die Länge zurück, oder 0, wenn das Dokument nicht in den Puffer passt.
+// ----------------------------------------
+size_t serializePayload(const JsonDocument& doc) {
+  size_t needed = measureJson(doc);
+  if (needed >= sizeof(mqttPayload)) {
+#ifdef ARDUINO
+    Serial.print("JSON-Payload zu groß für den Sendepuffer: ");
+    Serial.print(needed);
+    Serial.println(" Bytes");
+#endif
+    mqttPayload[0] = '\0';
+    return 0;
+  }
+  return serializeJson(doc, mqttPayload, sizeof(mqttPayload));
+}
+
+#endif // JSON_ARENA_H
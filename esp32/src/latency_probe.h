@@ -0,0 +1,157 @@
+#ifndef LATENCY_PROBE_H
+#define LATENCY_PROBE_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "sample_window.h"
+
+// ----------------------------------------
+// Latenz-Messung für GPIO-Befehle
+// Jeder gpio/set-Befehl bekommt einen Trace mit Zeitstempeln (micros())
+// bei Empfang, nach dem Parsen, nach dem Schalten und nach dem Serialisieren
+// des State-Reports (Publish beginnt).
+// Die Dauer jeder Stufe wird in SampleWindows gesammelt, so dass
+// Perzentile direkt auf dem Gerät abgefragt werden können.
+// ----------------------------------------
+
+#define LATENCY_WINDOW_SIZE 64     // Anzahl der Messwerte pro Stufe
+#define CORRELATION_ID_MAX_LEN 32  // Maximale Länge der Korrelations-ID
+
+// Zeitstempel eines einzelnen Befehls (alle Werte in µs seit Boot)
+struct CommandTrace {
+  bool active = false;
+  char cid[CORRELATION_ID_MAX_LEN + 1] = "";
+  uint32_t tReceive = 0;   // Callback betreten
+  uint32_t debugUs = 0;    // Debug-Ausgabe auf Serial (nicht Teil der Parse-Stufe)
+  uint32_t tParsed = 0;    // JSON geparst
+  uint32_t tActuated = 0;  // Alle Pins geschaltet
+  uint32_t tPublish = 0;   // State-Report serialisiert, Publish beginnt
+  uint32_t tPublished = 0; // client.publish() zurückgekehrt
+};
+
+// Aggregierte Statistiken pro Stufe (Dauer in µs)
+struct LatencyStats {
+  SampleWindow<uint32_t, LATENCY_WINDOW_SIZE> parse;      // Empfang -> geparst (ohne Debug-Ausgabe)
+  SampleWindow<uint32_t, LATENCY_WINDOW_SIZE> actuate;    // geparst -> geschaltet
+  SampleWindow<uint32_t, LATENCY_WINDOW_SIZE> serialize;  // geschaltet -> State-Report serialisiert
+  SampleWindow<uint32_t, LATENCY_WINDOW_SIZE> publish;    // serialisiert -> Publish abgeschlossen
+  SampleWindow<uint32_t, LATENCY_WINDOW_SIZE> total;    // Empfang -> Publish abgeschlossen
+  SampleWindow<uint32_t, LATENCY_WINDOW_SIZE> ping;     // Ping-Verarbeitung auf dem Gerät
+};
+
+// Globale Instanzen: der gerade laufende Befehl und die Statistik
+CommandTrace commandTrace;
+LatencyStats latencyStats;
+
+// ----------------------------------------
+// Funktion: beginCommandTrace
+// Startet einen neuen Trace. Muss so früh wie möglich im Callback
+// aufgerufen werden, damit die Empfangszeit möglichst genau ist.
+// debugUs: Dauer der Debug-Ausgabe zwischen Empfang und Trace-Beginn
+// ----------------------------------------
+void beginCommandTrace(uint32_t receivedAt, uint32_t debugUs) {
+  commandTrace.active = true;
+  commandTrace.cid[0] = '\0';
+  commandTrace.tReceive = receivedAt;
+  commandTrace.debugUs = debugUs;
+  commandTrace.tParsed = 0;
+  commandTrace.tActuated = 0;
+  commandTrace.tPublish = 0;
+  commandTrace.tPublished = 0;
+}
+
+// ----------------------------------------
+// Funktion: markCommandParsed
+// Merkt sich die (optionale) Korrelations-ID und den Parse-Zeitpunkt
+// ----------------------------------------
+void markCommandParsed(const char* cid) {
+  if (!commandTrace.active) return;
+  commandTrace.tParsed = micros();
+  if (cid != nullptr) {
+    strlcpy(commandTrace.cid, cid, sizeof(commandTrace.cid));
+  }
+}
+
+// Verwirft den laufenden Trace (z.B. bei ungültigem JSON)
+void cancelCommandTrace() {
+  commandTrace.active = false;
+}
+
+void markCommandActuated() {
+  if (!commandTrace.active) return;
+  commandTrace.tActuated = micros();
+}
+
+// ----------------------------------------
+// Funktion: appendCommandTiming
+// Hängt Korrelations-ID und Zeitstempel an einen State-Report an.
+// "rx" ist absolut (µs seit Boot), die übrigen Werte sind relativ zu "rx"
+// (ohne die Debug-Ausgabe). Serialisierung und Publish stehen erst nach dem
+// Serialisieren fest und sind daher nur in der Statistik enthalten.
+// ----------------------------------------
+void appendCommandTiming(JsonObject root) {
+  if (!commandTrace.active) return;
+
+  if (commandTrace.cid[0] != '\0') {
+    root["cid"] = commandTrace.cid;
+  }
+  JsonObject timing = root["timing"].to<JsonObject>();
+  timing["rx"] = commandTrace.tReceive;
+  timing["parse"] = commandTrace.tParsed - commandTrace.tReceive - commandTrace.debugUs;
+  if (commandTrace.tActuated != 0) { // Ohne geschalteten Pin kein Schaltzeitpunkt
+    timing["actuate"] = commandTrace.tActuated - commandTrace.tReceive - commandTrace.debugUs;
+  }
+}
+
+// Nach serializePayload() des State-Reports aufrufen (Publish beginnt)
+void markCommandSerialized() {
+  if (!commandTrace.active) return;
+  commandTrace.tPublish = micros();
+}
+
+// Direkt nach client.publish() des State-Reports aufrufen (vor weiteren Debug-Ausgaben)
+void markCommandPublished() {
+  if (!commandTrace.active) return;
+  commandTrace.tPublished = micros();
+}
+
+// ----------------------------------------
+// Funktion: finishCommandTrace
+// Schließt den Trace ab (nach client.publish) und übernimmt die
+// Stufen-Dauern in die Statistik
+// ----------------------------------------
+void finishCommandTrace() {
+  if (!commandTrace.active) return;
+  uint32_t now = commandTrace.tPublished != 0 ? commandTrace.tPublished : micros();
+
+  // Falls kein Pin geschaltet wurde, zählt die Schaltstufe als 0 µs
+  uint32_t tStart = commandTrace.tReceive + commandTrace.debugUs;
+  if (commandTrace.tParsed == 0) commandTrace.tParsed = tStart;
+  if (commandTrace.tActuated == 0) commandTrace.tActuated = commandTrace.tParsed;
+  if (commandTrace.tPublish == 0) commandTrace.tPublish = commandTrace.tActuated;
+
+  latencyStats.parse.add(commandTrace.tParsed - tStart);
+  latencyStats.actuate.add(commandTrace.tActuated - commandTrace.tParsed);
+  latencyStats.serialize.add(commandTrace.tPublish - commandTrace.tActuated);
+  latencyStats.publish.add(now - commandTrace.tPublish);
+  latencyStats.total.add(now - tStart);
+
+  commandTrace.active = false;
+}
+
+// ----------------------------------------
+// Funktion: latencyStatsToJson
+// Schreibt die Perzentil-Aggregate aller Stufen in ein JSON-Objekt
+// ----------------------------------------
+void latencyStatsToJson(JsonObject root) {
+  JsonObject stages = root["stages"].to<JsonObject>();
+  latencyStats.parse.toJson(stages["parse"].to<JsonObject>());
+  latencyStats.actuate.toJson(stages["actuate"].to<JsonObject>());
+  latencyStats.serialize.toJson(stages["serialize"].to<JsonObject>());
+  latencyStats.publish.toJson(stages["publish"].to<JsonObject>());
+  latencyStats.total.toJson(stages["total"].to<JsonObject>());
+  latencyStats.ping.toJson(root["ping"].to<JsonObject>());
+  root["unit"] = "us";
+}
+
+#endif // LATENCY_PROBE_H
@@ -0,0 +1,167 @@
+#ifndef LINK_QUALITY_H
+#define LINK_QUALITY_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <WiFi.h>
+#include <esp_wifi.h>
+#include "mqtt_session.h"    // mqttSession.connects
+#include "sample_window.h"
+
+// ----------------------------------------
+// Link-Qualität: RSSI, Verbindungsabbrüche, Publish-Fehler, MQTT-RTT
+// Wird im konfigurierbaren Intervall abgetastet (linkSampleInterval) und in
+// Fenster fester Größe geschrieben. Der Heartbeat enthält nur die Aggregate
+// (min/max/mean/p95), nicht die einzelnen Messwerte.
+// Die RTT wird über eine Probe gemessen, die das Gerät an sich selbst
+// veröffentlicht (esp32/<id>/link/probe, vom Gerät selbst abonniert):
+// Gerät -> Broker -> Gerät, ohne Beteiligung des Dashboards.
+// Jede Probe weckt Funkmodul und CPU. Im Light-Sleep-Modus wird daher keine
+// Probe gesendet (nur RSSI und Zähler, ohne Funkverkehr); das Standard-
+// intervall von 30 s hält auch in den anderen Modi die Zusatzlast gering.
+// ----------------------------------------
+
+#define LINK_WINDOW_SIZE 60              // 60 Messungen (bei 30 s = die letzten 30 Minuten)
+#define LINK_SAMPLE_INTERVAL_MIN 1000    // Kleinstes erlaubtes Abtastintervall (ms)
+#define LINK_PROBE_PAYLOAD_LEN 12        // Sequenznummer als Dezimalzahl
+
+struct LinkQuality {
+  uint32_t intervalMs = 30000;
+  uint32_t lastSampleAt = 0;             // millis() der letzten Messung
+
+  SampleWindow<int16_t, LINK_WINDOW_SIZE> rssi;           // dBm
+  SampleWindow<uint32_t, LINK_WINDOW_SIZE> rtt;           // µs, Probe Gerät -> Broker -> Gerät
+  SampleWindow<uint16_t, LINK_WINDOW_SIZE> disconnects;   // WLAN- + MQTT-Abbrüche pro Intervall
+  SampleWindow<uint16_t, LINK_WINDOW_SIZE> publishFails;  // Fehlgeschlagene Publishes pro Intervall
+
+  // Gesamtzähler seit Boot
+  volatile uint32_t wifiDisconnects = 0; // Wird im WiFi-Event-Task erhöht
+  volatile bool wifiConnectedOnce = false; // Erst danach zählen Abbrüche (nicht fehlgeschlagene Erstversuche)
+  uint32_t publishFailures = 0;
+  uint32_t probesSent = 0;
+  uint32_t probesLost = 0;
+
+  // Stand der Zähler bei der letzten Messung (für die Differenz pro Intervall)
+  uint32_t lastWifiDisconnects = 0;
+  uint32_t lastMqttConnects = 0;
+  uint32_t lastPublishFailures = 0;
+
+  // Ausstehende RTT-Probe
+  bool probePending = false;
+  uint32_t probeSeq = 0;
+  uint32_t probeSentAt = 0;              // micros()
+};
+
+LinkQuality linkQuality;
+
+// WiFi-Event: mit dem Access Point verbunden
+void onWifiConnected(WiFiEvent_t event, WiFiEventInfo_t info) {
+  linkQuality.wifiConnectedOnce = true;
+}
+
+// WiFi-Event: Verbindung zum Access Point verloren. Das Event kommt auch bei
+// jedem fehlgeschlagenen Verbindungsversuch; vor der ersten Verbindung nach
+// dem Boot ist das kein Abbruch.
+void onWifiDisconnected(WiFiEvent_t event, WiFiEventInfo_t info) {
+  if (linkQuality.wifiConnectedOnce) linkQuality.wifiDisconnects++;
+}
+
+void setLinkSampleInterval(long intervalMs) {
+  if (intervalMs < LINK_SAMPLE_INTERVAL_MIN) intervalMs = LINK_SAMPLE_INTERVAL_MIN;
+  linkQuality.intervalMs = intervalMs;
+}
+
+void initLinkQuality(long intervalMs) {
+  setLinkSampleInterval(intervalMs);
+  WiFi.onEvent(onWifiConnected, ARDUINO_EVENT_WIFI_STA_CONNECTED);
+  WiFi.onEvent(onWifiDisconnected, ARDUINO_EVENT_WIFI_STA_DISCONNECTED);
+  linkQuality.lastSampleAt = millis();
+}
+
+// Wird von mqttPublish() nach jedem Publish aufgerufen
+void recordPublishResult(bool ok) {
+  if (!ok) linkQuality.publishFailures++;
+}
+
+// Millisekunden bis zur nächsten fälligen Messung (für waitForEvents)
+uint32_t millisUntilLinkSample(uint32_t now) {
+  uint32_t elapsed = now - linkQuality.lastSampleAt;
+  return elapsed >= linkQuality.intervalMs ? 0 : linkQuality.intervalMs - elapsed;
+}
+
+// ----------------------------------------
+// Funktion: sampleLink
+// Nimmt eine Messung auf (RSSI, Zähler-Differenzen, verlorene Probe).
+// Gibt true zurück, wenn der Aufrufer eine neue RTT-Probe senden soll;
+// probePayload enthält dann die Sequenznummer. allowProbe = false, wenn
+// keine Verbindung besteht oder der Energiesparmodus keine Probe zulässt.
+// ----------------------------------------
+bool sampleLink(bool allowProbe, char* probePayload, size_t probePayloadLen) {
+  linkQuality.lastSampleAt = millis();
+
+  wifi_ap_record_t apInfo;
+  if (WiFi.status() == WL_CONNECTED && esp_wifi_sta_get_ap_info(&apInfo) == ESP_OK) {
+    linkQuality.rssi.add(apInfo.rssi);
+  }
+
+  uint32_t wifiDisconnects = linkQuality.wifiDisconnects;
+  uint32_t mqttConnects = mqttSession.connects;
+  // Der erste Connect nach dem Boot ist kein Abbruch
+  uint32_t mqttReconnects = mqttConnects - linkQuality.lastMqttConnects;
+  if (linkQuality.lastMqttConnects == 0 && mqttReconnects > 0) mqttReconnects--;
+  linkQuality.disconnects.add(wifiDisconnects - linkQuality.lastWifiDisconnects + mqttReconnects);
+  linkQuality.publishFails.add(linkQuality.publishFailures - linkQuality.lastPublishFailures);
+  linkQuality.lastWifiDisconnects = wifiDisconnects;
+  linkQuality.lastMqttConnects = mqttConnects;
+  linkQuality.lastPublishFailures = linkQuality.publishFailures;
+
+  // Probe aus dem letzten Intervall nicht zurückgekommen -> verloren
+  if (linkQuality.probePending) {
+    linkQuality.probesLost++;
+    linkQuality.probePending = false;
+  }
+
+  if (!allowProbe) return false;
+
+  linkQuality.probeSeq++;
+  snprintf(probePayload, probePayloadLen, "%lu", (unsigned long)linkQuality.probeSeq);
+  linkQuality.probePending = true;
+  linkQuality.probesSent++;
+  linkQuality.probeSentAt = micros();
+  return true;
+}
+
+// ----------------------------------------
+// Funktion: handleLinkProbe
+// Probe ist über die eigene Subscription zurückgekommen -> RTT erfassen
+// ----------------------------------------
+void handleLinkProbe(const byte* payload, unsigned int length, uint32_t receivedAt) {
+  char buffer[LINK_PROBE_PAYLOAD_LEN];
+  size_t n = length < sizeof(buffer) - 1 ? length : sizeof(buffer) - 1;
+  memcpy(buffer, payload, n);
+  buffer[n] = '\0';
+
+  // Nur die zuletzt gesendete Probe zählt (verspätete gelten bereits als verloren)
+  if (!linkQuality.probePending || strtoul(buffer, nullptr, 10) != linkQuality.probeSeq) return;
+  linkQuality.probePending = false;
+  linkQuality.rtt.add(receivedAt - linkQuality.probeSentAt);
+}
+
+// ----------------------------------------
+// Funktion: linkStatsToJson
+// Schreibt die Aggregate der Link-Qualität in ein JSON-Objekt (für den Heartbeat)
+// ----------------------------------------
+void linkStatsToJson(JsonObject obj) {
+  obj["intervalMs"] = linkQuality.intervalMs;
+  linkQuality.rssi.summaryToJson(obj["rssi"].to<JsonObject>());
+  linkQuality.rtt.summaryToJson(obj["rttUs"].to<JsonObject>());
+  linkQuality.disconnects.summaryToJson(obj["disconnects"].to<JsonObject>());
+  linkQuality.publishFails.summaryToJson(obj["publishFails"].to<JsonObject>());
+  obj["wifiDisconnects"] = linkQuality.wifiDisconnects;
+  obj["mqttReconnects"] = mqttSession.connects > 0 ? mqttSession.connects - 1 : 0;
+  obj["publishFailures"] = linkQuality.publishFailures;
+  obj["probesSent"] = linkQuality.probesSent;
+  obj["probesLost"] = linkQuality.probesLost;
+}
+
+#endif // LINK_QUALITY_H
@@ -3,6 +3,7 @@
 
 #include <LittleFS.h>
 #include <ArduinoJson.h>
+#include "json_arena.h"
 
 // ----------------------------------------
 // LittleFS Settings Verwaltung
@@ -12,17 +13,26 @@
 #define SETTINGS_FILE "/settings.json"
 #define FORMAT_LITTLEFS_IF_FAILED true
 
+// Feste Puffergrößen statt String, damit keine Heap-Fragmentierung entsteht
+#define DEVICE_NAME_MAX_LEN 32
+#define GPIO_GROUP_MAX_LEN 16
+#define GPIO_LABEL_MAX_LEN 32
+#define GPIO_MODE_MAX_LEN 8
+
 // Struktur für die Geräteeinstellungen
 struct DeviceSettings {
   long wifiScanInterval = 60000;  // Standard: 60 Sekunden
-  String deviceName = "ESP32-Dashboard";
+  char deviceName[DEVICE_NAME_MAX_LEN] = "ESP32-Dashboard";
+  int powerMode = 0;              // 0 = Performance, 1 = DFS, 2 = Light Sleep (siehe power_manager.h)
+  long linkSampleInterval = 30000; // Standard: 30 Sekunden, RSSI/RTT (siehe link_quality.h)
 };
 
 // Struktur für GPIO-Metadaten (Label / Group)
 struct GPIOConfig {
   int pinNumber = -1;
-  String group = "none"; // "lamp" | "pump" | "none"
-  String label = "";
+  char group[GPIO_GROUP_MAX_LEN] = "none"; // "lamp" | "pump" | "none"
+  char label[GPIO_LABEL_MAX_LEN] = "";
+  char mode[GPIO_MODE_MAX_LEN] = "digital"; // "digital" | "pwm" (LEDC, dimmbar)
 };
 
 // Externe Referenzen: werden in main.cpp definiert
@@ -63,20 +73,23 @@ bool initLittleFS() {
 bool saveSettings() {
   Serial.println("Speichere Settings auf LittleFS...");
 
-  // Erstelle ein JSON-Dokument
-  DynamicJsonDocument doc(512);
+  // Erstelle ein JSON-Dokument (Speicher aus der statischen JSON-Arena)
+  JsonDocument doc(&jsonArena);
 
   // Füge die aktuellen Einstellungen hinzu
   doc["wifiScanInterval"] = deviceSettings.wifiScanInterval;
   doc["deviceName"] = deviceSettings.deviceName;
+  doc["powerMode"] = deviceSettings.powerMode;
+  doc["linkSampleInterval"] = deviceSettings.linkSampleInterval;
 
   // Wenn GPIO-Metadaten vorhanden sind, in die Settings schreiben
-  JsonArray gpioArray = doc.createNestedArray("gpioConfigs");
+  JsonArray gpioArray = doc["gpioConfigs"].to<JsonArray>();
   for (int i = 0; i < NUM_PINS; i++) {
-    JsonObject g = gpioArray.createNestedObject();
+    JsonObject g = gpioArray.add<JsonObject>();
     g["pinNumber"] = gpioConfigs[i].pinNumber;
     g["group"] = gpioConfigs[i].group;
     g["label"] = gpioConfigs[i].label;
+    g["mode"] = gpioConfigs[i].mode;
   }
 
   // Öffne die Datei zum Schreiben (überschreibe, falls sie existiert)
@@ -124,8 +137,8 @@ bool loadSettings() {
     return false;
   }
 
-  // Erstelle ein JSON-Dokument (512 Bytes reichen aus)
-  DynamicJsonDocument doc(512);
+  // Erstelle ein JSON-Dokument (Speicher aus der statischen JSON-Arena)
+  JsonDocument doc(&jsonArena);
 
   // Versuche, die JSON zu parsen
   DeserializationError error = deserializeJson(doc, settingsFile);
@@ -138,27 +151,40 @@ bool loadSettings() {
   }
 
   // Extrahiere die Einstellungen aus der JSON
-  if (doc.containsKey("wifiScanInterval")) {
+  if (!doc["wifiScanInterval"].isNull()) {
     deviceSettings.wifiScanInterval = doc["wifiScanInterval"].as<long>();
     Serial.print("wifiScanInterval geladen: ");
     Serial.println(deviceSettings.wifiScanInterval);
   }
 
-  if (doc.containsKey("deviceName")) {
-    deviceSettings.deviceName = doc["deviceName"].as<String>();
+  if (!doc["deviceName"].isNull()) {
+    strlcpy(deviceSettings.deviceName, doc["deviceName"] | "", sizeof(deviceSettings.deviceName));
     Serial.print("deviceName geladen: ");
     Serial.println(deviceSettings.deviceName);
   }
 
+  if (!doc["powerMode"].isNull()) {
+    deviceSettings.powerMode = doc["powerMode"].as<int>();
+    Serial.print("powerMode geladen: ");
+    Serial.println(deviceSettings.powerMode);
+  }
+
+  if (!doc["linkSampleInterval"].isNull()) {
+    deviceSettings.linkSampleInterval = doc["linkSampleInterval"].as<long>();
+    Serial.print("linkSampleInterval geladen: ");
+    Serial.println(deviceSettings.linkSampleInterval);
+  }
+
   // Lade GPIO-Metadaten falls vorhanden
-  if (doc.containsKey("gpioConfigs") && doc["gpioConfigs"].is<JsonArray>()) {
+  if (doc["gpioConfigs"].is<JsonArray>()) {
     JsonArray ga = doc["gpioConfigs"].as<JsonArray>();
     int idx = 0;
     for (JsonObject g : ga) {
       if (idx >= NUM_PINS) break;
-      if (g.containsKey("pinNumber")) gpioConfigs[idx].pinNumber = g["pinNumber"].as<int>();
-      if (g.containsKey("group")) gpioConfigs[idx].group = g["group"].as<String>();
-      if (g.containsKey("label")) gpioConfigs[idx].label = g["label"].as<String>();
+      if (!g["pinNumber"].isNull()) gpioConfigs[idx].pinNumber = g["pinNumber"].as<int>();
+      if (!g["group"].isNull()) strlcpy(gpioConfigs[idx].group, g["group"] | "none", sizeof(gpioConfigs[idx].group));
+      if (!g["label"].isNull()) strlcpy(gpioConfigs[idx].label, g["label"] | "", sizeof(gpioConfigs[idx].label));
+      if (!g["mode"].isNull()) strlcpy(gpioConfigs[idx].mode, g["mode"] | "digital", sizeof(gpioConfigs[idx].mode));
       idx++;
     }
     Serial.println("GPIO-Metadaten geladen aus Settings.");
@@ -195,12 +221,18 @@ void printSettings() {
   Serial.println(" ms");
   Serial.print("Gerätename: ");
   Serial.println(deviceSettings.deviceName);
+  Serial.print("Energiesparmodus: ");
+  Serial.println(deviceSettings.powerMode);
+  Serial.print("Link-Abtastintervall: ");
+  Serial.print(deviceSettings.linkSampleInterval);
+  Serial.println(" ms");
   // GPIO Metadata ausgeben (falls definiert)
   Serial.println("GPIO Metadaten:");
   for (int i = 0; i < NUM_PINS; i++) {
     Serial.print("  Pin "); Serial.print(gpioConfigs[i].pinNumber);
     Serial.print(" - Group: "); Serial.print(gpioConfigs[i].group);
-    Serial.print(" - Label: "); Serial.println(gpioConfigs[i].label);
+    Serial.print(" - Label: "); Serial.print(gpioConfigs[i].label);
+    Serial.print(" - Mode: "); Serial.println(gpioConfigs[i].mode);
   }
   Serial.println("===========================================\n");
 }
@@ -1,7 +1,19 @@
 #include "secrets.h"      // Enthält vertrauliche WLAN- und MQTT-Zugangsdaten. MUSS in .gitignore!
 #include "littlefs_settings.h" // LittleFS-Verwaltung für Geräteeinstellungen
+#include "latency_probe.h"    // Latenz-Messung für GPIO-Befehle (Trace + Perzentile)
+#include "json_arena.h"       // Statische Arena für JSON-Dokumente + Sendepuffer
+#include "heap_watchdog.h"    // Überwachung von freiem Heap und Fragmentierung
+#include "power_manager.h"    // Ereignisgesteuerte Hauptschleife + Energiesparmodi
+#include "ota_update.h"       // Firmware-Update über MQTT (Chunks direkt in die OTA-Partition)
+#include "pwm_output.h"       // Dimmbare Ausgänge über LEDC inkl. Hardware-Fades
+#include "gpio_groups.h"      // Gruppen-Index für flottenweite GPIO-Befehle
+#include "mqtt_session.h"     // Persistente Session, Reconnect-Messung, Erkennung wiederholter Befehle
+#include "link_quality.h"     // RSSI/RTT/Abbrüche abtasten, Aggregate für den Heartbeat
+#include "handler_profile.h"  // Laufzeit und Speicherverbrauch pro Nachrichtentyp
+#include "traffic_capture.h"  // MQTT-Verkehr auf LittleFS aufzeichnen, exportieren und wiedergeben
 #include <ArduinoJson.h>  // Bibliothek für effizientes JSON-Parsing und -Generierung
 #include <WiFi.h>         // Bibliothek für WLAN-Funktionalität
+#include <esp_wifi.h>     // Für esp_wifi_sta_get_ap_info() (SSID/RSSI ohne String-Kopie)
 #include <PubSubClient.h> // Bibliothek für MQTT-Kommunikation
 #include <Esp.h>          // Für ESP-spezifische Funktionen wie ESP.getFreeHeap()
 
@@ -23,21 +35,38 @@ const char* mqtt_pass = MQTT_PASSWORD;      // MQTT-Passwort
 
 // Globale Variablen für die Geräte-ID und MQTT-Topics.
 // Diese werden dynamisch in setup() initialisiert, da deviceId von der MAC abhängt.
-String deviceId;                  // Eindeutige Geräte-ID basierend auf der MAC-Adresse
-String topic_status_get_all_sub;  // Topic zum Abonnieren von Anfragen für den Online-Status/Heartbeats aller Geräte
-String topic_status_pub;          // Topic zum Veröffentlichen des Online-Status/Heartbeats
-String topic_status_get_sub;      // Topic zum Abonnieren von Anfragen für den Status
-String topic_wifi_scan_pub;       // Topic zum Veröffentlichen von WiFi-Scan-Ergebnissen
-String topic_wifi_get_sub;        // Topic zum Abonnieren von Anfragen für WiFi-Scan
-String topic_gpio_state_pub;      // Topic zum Veröffentlichen des aktuellen GPIO-Status
-String topic_gpio_get_sub;        // Topic zum Abonnieren von Anfragen für den GPIO-Status
-String topic_gpio_set_sub;        // Topic zum Abonnieren von Befehlen zur GPIO-Steuerung
-String topic_settings_get_sub;    // Topic zum Abonnieren von Anfragen für die Einstellungen
-String topic_settings_pub;        // Topic zum Veröffentlichen der Einstellungen
-String topic_settings_set_sub;    // Topic zum Abonnieren von Befehlen zur Einstellung der Geräteeinstellungen
+// Feste Puffer statt String, damit beim Aufbau keine Heap-Fragmentierung entsteht.
+#define TOPIC_MAX_LEN 64
+
+char deviceId[13];                             // Eindeutige Geräte-ID basierend auf der MAC-Adresse
+char topic_device_sub[TOPIC_MAX_LEN];          // Frühere Wildcard-Subscription (esp32/<id>/+/+), wird beim Connect gekündigt
+char topic_broadcast_sub[TOPIC_MAX_LEN];       // Frühere Wildcard-Subscription (esp32/all/+/+), wird beim Connect gekündigt
+char topic_status_get_all_sub[TOPIC_MAX_LEN];  // Topic zum Abonnieren von Anfragen für den Online-Status/Heartbeats aller Geräte
+char topic_status_pub[TOPIC_MAX_LEN];          // Topic zum Veröffentlichen des Online-Status/Heartbeats
+char topic_status_get_sub[TOPIC_MAX_LEN];      // Topic zum Abonnieren von Anfragen für den Status
+char topic_wifi_scan_pub[TOPIC_MAX_LEN];       // Topic zum Veröffentlichen von WiFi-Scan-Ergebnissen
+char topic_wifi_get_sub[TOPIC_MAX_LEN];        // Topic zum Abonnieren von Anfragen für WiFi-Scan
+char topic_gpio_state_pub[TOPIC_MAX_LEN];      // Topic zum Veröffentlichen des aktuellen GPIO-Status
+char topic_gpio_get_sub[TOPIC_MAX_LEN];        // Topic zum Abonnieren von Anfragen für den GPIO-Status
+char topic_gpio_set_sub[TOPIC_MAX_LEN];        // Topic zum Abonnieren von Befehlen zur GPIO-Steuerung
+char topic_settings_get_sub[TOPIC_MAX_LEN];    // Topic zum Abonnieren von Anfragen für die Einstellungen
+char topic_settings_pub[TOPIC_MAX_LEN];        // Topic zum Veröffentlichen der Einstellungen
+char topic_settings_set_sub[TOPIC_MAX_LEN];    // Topic zum Abonnieren von Befehlen zur Einstellung der Geräteeinstellungen
+char topic_latency_get_sub[TOPIC_MAX_LEN];     // Topic zum Abonnieren von Anfragen für die Latenz-Statistik
+char topic_latency_pub[TOPIC_MAX_LEN];         // Topic zum Veröffentlichen der Latenz-Statistik
+char topic_ping_sub[TOPIC_MAX_LEN];            // Topic zum Abonnieren von Ping-Anfragen (Round-Trip-Messung)
+char topic_pong_pub[TOPIC_MAX_LEN];            // Topic zum Veröffentlichen der Pong-Antworten
+char topic_ota_begin_sub[TOPIC_MAX_LEN];       // Topic zum Abonnieren des OTA-Starts (Größe + SHA-256)
+char topic_ota_chunk_sub[TOPIC_MAX_LEN];       // Topic zum Abonnieren der OTA-Chunks (binär)
+char topic_ota_abort_sub[TOPIC_MAX_LEN];       // Topic zum Abonnieren des OTA-Abbruchs
+char topic_ota_status_pub[TOPIC_MAX_LEN];      // Topic zum Veröffentlichen des OTA-Status/Fortschritts
+char topic_link_probe[TOPIC_MAX_LEN];          // RTT-Probe: wird veröffentlicht und über die eigene Wildcard empfangen
+char topic_capture_cmd_sub[TOPIC_MAX_LEN];     // Topic zum Abonnieren der Capture-Befehle (start/stop/export/replay/profile)
+char topic_capture_pub[TOPIC_MAX_LEN];         // Topic zum Veröffentlichen des Capture-Status und Handler-Profils
+char topic_capture_data_pub[TOPIC_MAX_LEN];    // Topic zum Veröffentlichen der Export-Chunks (binär, außerhalb der Wildcard)
 
 // Globale Variablen für den nicht-blockierenden Scan
-String currentDeviceName = BASE_DEVICE_NAME; // TODO: add this later | Gerätenamen anpassen
+char currentDeviceName[DEVICE_NAME_MAX_LEN] = BASE_DEVICE_NAME; // TODO: add this later | Gerätenamen anpassen
 bool wifiScanning = false;        // Flag, ob ein WiFi-Scan läuft
 
 // ----------------------------------------
@@ -51,36 +80,131 @@ long lastWifiScanTime = 0;        // Zeitpunkt des letzten WiFi-Scans
 long wifiScanInterval = 60000;  // Intervall für WiFi-Scans (wird von LittleFS geladen)
 
 // Instanzen für die WLAN- und MQTT-Kommunikation
+// tls_client.h nur bei TLS einbinden: es setzt arduino-esp32 2.0.x voraus
+// (platformio.ini), die Klartext-Firmware baut auch mit anderen Cores
+#if MQTT_USE_TLS
+#include "tls_client.h"       // TLS-Client mit Session-Wiederaufnahme
+ResumableTlsClient espClient;     // TLS-Client; Sessions werden über Reconnects/Neustarts wiederaufgenommen
+#else
 WiFiClient espClient;             // Der TCP-Client, der die WLAN-Verbindung verwaltet
+#endif
 PubSubClient client(espClient);   // Der MQTT-Client, der über espClient kommuniziert
 
+// Funktionsprototypen: Diese Funktionen werden im Callback bzw. vor ihrer
+// Definition verwendet (in .cpp-Dateien erzeugt der Compiler keine Prototypen)
+void sendHeartbeat();
+void performWifiScan();
+void processWifiScanResults(int n);
+void reportGpioStates();
+void handlePing(const byte* payload, unsigned int length, uint32_t receivedAt);
+void sendLatencyStats();
+void handleOtaBegin(const byte* payload, unsigned int length);
+void publishOtaStatus(bool retained);
+void handleCaptureCommand(const byte* payload, unsigned int length);
+void publishCaptureStatus(bool withProfile, const char* error = nullptr);
+
+// ----------------------------------------
+// Funktion: buildTopic
+// Setzt ein gerätespezifisches Topic "esp32/<deviceId>/<suffix>" zusammen
+// ----------------------------------------
+void buildTopic(char* buffer, const char* suffix) {
+  snprintf(buffer, TOPIC_MAX_LEN, "esp32/%s/%s", deviceId, suffix);
+}
+
+// ----------------------------------------
+// Funktion: mqttPublish
+// Veröffentlicht eine Nachricht und zählt fehlgeschlagene Publishes
+// für die Link-Statistik
+// ----------------------------------------
+bool mqttPublish(const char* topic, const char* payload, bool retained = false) {
+  bool ok = client.publish(topic, payload, retained);
+  recordPublishResult(ok);
+  return ok;
+}
+
+// Variante für binäre Payloads (z.B. Capture-Export)
+bool mqttPublish(const char* topic, const uint8_t* payload, size_t length, bool retained = false) {
+  bool ok = client.publish(topic, payload, length, retained);
+  recordPublishResult(ok);
+  return ok;
+}
+
+// ----------------------------------------
+// Funktion: subscribeCommandTopics
+// Abonniert die Befehls-Topics einzeln mit QoS 1. Eine Wildcard wie
+// esp32/<id>/+/+ würde auch die eigenen Veröffentlichungen (gpio/state,
+// wifi/scan, pong, ota/status) zurückliefern (MQTT 3.1.1 kennt kein
+// "no local") und Funkverkehr und Aufwachvorgänge verdoppeln.
+// ----------------------------------------
+void subscribeCommandTopics() {
+  const char* const commandTopics[] = {
+    topic_gpio_set_sub, topic_gpio_get_sub, topic_status_get_sub, topic_wifi_get_sub,
+    topic_settings_get_sub, topic_settings_set_sub, topic_latency_get_sub, topic_ping_sub,
+    topic_ota_begin_sub, topic_ota_chunk_sub, topic_ota_abort_sub, topic_capture_cmd_sub,
+    topic_link_probe, topic_status_get_all_sub, GPIO_ALL_SET_TOPIC
+  };
+  for (const char* commandTopic : commandTopics) {
+    client.subscribe(commandTopic, 1);
+  }
+
+  // Wildcards älterer Firmware kündigen: Mit cleanSession=false hält der Broker sie sonst weiter
+  client.unsubscribe(topic_device_sub);
+  client.unsubscribe(topic_broadcast_sub);
+}
+
+// ----------------------------------------
+// Funktion: subscribeGroupTopics
+// Abonniert (bzw. kündigt) die Gruppen-Topics aller Gruppen dieses Geräts
+// ----------------------------------------
+void subscribeGroupTopics(bool subscribe) {
+  for (int g = 0; g < gpioIndex.groupCount; g++) {
+    const char* groupTopic = gpioIndex.groups[g].topic;
+    if (groupTopic[0] == '\0') continue;
+    if (subscribe) client.subscribe(groupTopic, 1);
+    else client.unsubscribe(groupTopic);
+  }
+}
+
+// ----------------------------------------
+// Funktion: refreshGpioIndex
+// Baut den Gruppen-Index nach einer Konfigurationsänderung neu auf und
+// passt die Gruppen-Subscriptions an
+// ----------------------------------------
+void refreshGpioIndex() {
+  if (client.connected()) subscribeGroupTopics(false);
+  rebuildGpioIndex();
+  if (client.connected()) subscribeGroupTopics(true);
+}
+
 // ----------------------------------------
 // Funktion: sendDeviceSettings
 // Sendet die aktuellen Geräteeinstellungen als JSON an topic_settings_pub.
 // ----------------------------------------
 void sendDeviceSettings() {
-  DynamicJsonDocument doc(512); // Ausreichend für alle Einstellungen
+  JsonDocument doc(&jsonArena); // Speicher aus der statischen JSON-Arena
 
   doc["deviceName"] = currentDeviceName;
   doc["wifiScanInterval"] = wifiScanInterval; // Der aktuell aktive Wert
+  doc["powerMode"] = powerStats.mode;         // Aktiver Energiesparmodus
+  doc["linkSampleInterval"] = linkQuality.intervalMs; // Abtastintervall der Link-Qualität
 
   // GPIO Metadaten anhängen
-  JsonArray gpioArray = doc.createNestedArray("gpioConfigs");
+  JsonArray gpioArray = doc["gpioConfigs"].to<JsonArray>();
   for (int i = 0; i < NUM_PINS; i++) {
-    JsonObject g = gpioArray.createNestedObject();
+    JsonObject g = gpioArray.add<JsonObject>();
     g["pinNumber"] = gpioConfigs[i].pinNumber;
     g["group"] = gpioConfigs[i].group;
     g["label"] = gpioConfigs[i].label;
+    g["mode"] = gpioConfigs[i].mode;
   }
 
-  String payload;
-  serializeJson(doc, payload);
+  if (serializePayload(doc) == 0) return;
 
   Serial.print("Sende Geräteeinstellungen: ");
-  Serial.println(payload);
+  Serial.println(mqttPayload);
 
   if (client.connected()) {
-    client.publish(topic_settings_pub.c_str(), payload.c_str());
+    mqttPublish(topic_settings_pub, mqttPayload);
   } else {
     Serial.println("MQTT Client ist NICHT verbunden, Einstellungen nicht gesendet.");
   }
@@ -91,10 +215,10 @@ void sendDeviceSettings() {
 // Aktualisiert Geräteeinstellungen basierend auf einer JSON-Nachricht.
 // Speichert die Änderungen und sendet den aktualisierten Zustand zurück.
 // ----------------------------------------
-void updateDeviceSettings(String payloadString) {
-  DynamicJsonDocument doc(512);
+void updateDeviceSettings(const byte* payload, unsigned int length) {
+  JsonDocument doc(&jsonArena);
 
-  DeserializationError error = deserializeJson(doc, payloadString);
+  DeserializationError error = deserializeJson(doc, payload, length);
 
   if (error) {
     Serial.print(F("JSON-Parsing für Settings fehlgeschlagen: "));
@@ -104,17 +228,17 @@ void updateDeviceSettings(String payloadString) {
 
   bool settingsChanged = false;
 
-  if (doc.containsKey("deviceName")) {
-    String newName = doc["deviceName"].as<String>();
-    if (newName != currentDeviceName) {
-      currentDeviceName = newName;
-      deviceSettings.deviceName = newName;
+  if (!doc["deviceName"].isNull()) {
+    const char* newName = doc["deviceName"] | "";
+    if (strcmp(newName, currentDeviceName) != 0) {
+      strlcpy(currentDeviceName, newName, sizeof(currentDeviceName));
+      strlcpy(deviceSettings.deviceName, newName, sizeof(deviceSettings.deviceName));
       Serial.print("Gerätename aktualisiert zu: "); Serial.println(currentDeviceName);
       settingsChanged = true;
     }
   }
 
-  if (doc.containsKey("wifiScanInterval")) {
+  if (!doc["wifiScanInterval"].isNull()) {
     long newInterval = doc["wifiScanInterval"].as<long>();
     // Intervall muss mindestens 5 Sekunden sein und muss sich vom aktuellen Wert unterscheiden
     if (newInterval > 5000 && newInterval != wifiScanInterval) { 
@@ -127,6 +251,75 @@ void updateDeviceSettings(String payloadString) {
     }
   }
 
+  if (!doc["powerMode"].isNull()) {
+    int newMode = doc["powerMode"].as<int>();
+    if (newMode >= POWER_MODE_PERFORMANCE && newMode <= POWER_MODE_LIGHT_SLEEP && newMode != powerStats.mode) {
+      applyPowerMode(newMode);
+      deviceSettings.powerMode = newMode;
+      settingsChanged = true;
+    } else {
+      Serial.print("Ungültiger oder unveränderter Energiesparmodus: "); Serial.println(newMode);
+    }
+  }
+
+  if (!doc["linkSampleInterval"].isNull()) {
+    long newInterval = doc["linkSampleInterval"].as<long>();
+    if (newInterval >= LINK_SAMPLE_INTERVAL_MIN && newInterval != (long)linkQuality.intervalMs) {
+      setLinkSampleInterval(newInterval);
+      deviceSettings.linkSampleInterval = newInterval;
+      Serial.print("Link-Abtastintervall aktualisiert zu: "); Serial.println(newInterval);
+      settingsChanged = true;
+    } else {
+      Serial.print("Ungültiges oder unverändertes Link-Abtastintervall: "); Serial.println(newInterval);
+    }
+  }
+
+  // GPIO-Metadaten pro Pin aktualisieren (Zuordnung über pinNumber)
+  bool gpioIndexChanged = false;
+  if (doc["gpioConfigs"].is<JsonArray>()) {
+    for (JsonObject g : doc["gpioConfigs"].as<JsonArray>()) {
+      int pinNumber = g["pinNumber"] | -1;
+      for (int i = 0; i < NUM_PINS; i++) {
+        if (gpioConfigs[i].pinNumber != pinNumber) continue;
+
+        // Nur bei tatsächlicher Änderung speichern bzw. den Index neu aufbauen
+        // (Vergleich nach dem Kürzen auf die Puffergröße)
+        if (g["group"].is<const char*>()) {
+          char newGroup[GPIO_GROUP_MAX_LEN];
+          strlcpy(newGroup, g["group"], sizeof(newGroup));
+          if (strcmp(newGroup, gpioConfigs[i].group) != 0) {
+            strlcpy(gpioConfigs[i].group, newGroup, sizeof(gpioConfigs[i].group));
+            gpioIndexChanged = true;
+            settingsChanged = true;
+          }
+        }
+        // Labels werden direkt in gpioConfigs gesucht, der Gruppen-Index bleibt gültig
+        if (g["label"].is<const char*>()) {
+          char newLabel[GPIO_LABEL_MAX_LEN];
+          strlcpy(newLabel, g["label"], sizeof(newLabel));
+          if (strcmp(newLabel, gpioConfigs[i].label) != 0) {
+            strlcpy(gpioConfigs[i].label, newLabel, sizeof(gpioConfigs[i].label));
+            settingsChanged = true;
+          }
+        }
+        const char* newMode = g["mode"] | "";
+        if ((strcmp(newMode, "digital") == 0 || strcmp(newMode, "pwm") == 0) &&
+            strcmp(newMode, gpioConfigs[i].mode) != 0) {
+          strlcpy(gpioConfigs[i].mode, newMode, sizeof(gpioConfigs[i].mode));
+          configureOutput(i); // Pin sofort auf LEDC bzw. GPIO-Ausgang umstellen
+          Serial.print("GPIO "); Serial.print(pinNumber);
+          Serial.print(" Modus: "); Serial.println(newMode);
+          settingsChanged = true;
+        }
+      }
+    }
+  }
+
+  // Gruppen geändert: Index für Flottenbefehle neu aufbauen
+  if (gpioIndexChanged) {
+    refreshGpioIndex();
+  }
+
   // Nach der Aktualisierung die neuen Einstellungen zurücksenden und speichern,
   // damit das Frontend weiß, dass die Änderung übernommen wurde.
   if (settingsChanged) {
@@ -163,109 +356,250 @@ const int NUM_PINS = sizeof(control_pins) / sizeof(control_pins[0]);
 GPIOConfig gpioConfigs[NUM_PINS];
 
 // ----------------------------------------
-// Funktion: MQTT Callback
-// Wird aufgerufen, wenn eine Nachricht auf einem abonnierten Topic empfangen wird
+// Funktion: applyGpioCommand
+// Wertet ein einzelnes Befehlsobjekt aus und schaltet alle ausgewählten Pins.
+// Zustand als "state" (1/0, "ON"/"OFF", ...) oder für PWM-Pins "duty" (0-100 %)
+// mit optionalem "fadeMs". quiet = keine Fehlermeldungen auf Serial
+// (Flottenbefehle betreffen die meisten Geräte nicht).
+// Gibt die Bitmaske der geschalteten Pin-Indizes zurück.
 // ----------------------------------------
-void callback(char* topic, byte* payload, unsigned int length) {
+uint32_t applyGpioCommand(JsonObject pinObj, const char* impliedGroup, bool quiet) {
+  if (pinObj["state"].isNull() && pinObj["duty"].isNull()) {
+    if (!quiet) Serial.println("Fehler: Fehlendes Feld 'state'/'duty' in GPIO-Befehl");
+    return 0;
+  }
+
+  uint32_t targets = resolveGpioTargets(pinObj, impliedGroup);
+  if (targets == 0) {
+    if (!quiet) {
+      Serial.print("Befehl für unbekannten oder nicht steuerbaren Pin empfangen: ");
+      serializeJson(pinObj, Serial);
+      Serial.println();
+    }
+    return 0;
+  }
+
+  JsonVariant stateVar = pinObj["state"];       // Zustand als Zahl (1/0) oder String ("ON", "OFF", "1", "0")
+  const char* stateStr = stateVar.is<const char*>() ? stateVar.as<const char*>() : "";
+
+  int newState = LOW; // Standardmäßig LOW
+  // Konvertiere den Zustand in HIGH/LOW
+  if (stateVar.isNull()) {
+    newState = (pinObj["duty"] | 0.0f) > 0 ? HIGH : LOW;
+  } else if (stateVar.is<int>()) {
+    newState = stateVar.as<int>() ? HIGH : LOW;
+  } else if (strcmp(stateStr, "ON") == 0 || strcmp(stateStr, "1") == 0 || strcmp(stateStr, "HIGH") == 0) {
+    newState = HIGH;
+  } else if (strcmp(stateStr, "OFF") == 0 || strcmp(stateStr, "0") == 0 || strcmp(stateStr, "LOW") == 0) {
+    newState = LOW;
+  } else {
+    if (!quiet) {
+      Serial.print("Unbekannter Zustand: ");
+      Serial.println(stateStr);
+    }
+    return 0;
+  }
+
+  for (int i = 0; i < NUM_PINS; i++) {
+    if (!(targets & (1UL << i))) continue;
+
+    if (isPwmPin(i)) {
+      // Ohne "duty" schaltet "state" den PWM-Pin voll ein bzw. aus
+      float duty = pinObj["duty"] | (newState == HIGH ? 100.0f : 0.0f);
+      uint32_t fadeMs = pinObj["fadeMs"] | 0;
+      setPwmDuty(i, duty, fadeMs); // Rampe läuft in der LEDC-Hardware weiter
+      Serial.print("GPIO ");
+      Serial.print(control_pins[i]);
+      Serial.print(" PWM auf ");
+      Serial.print(duty);
+      Serial.print(" % in ");
+      Serial.print(fadeMs);
+      Serial.println(" ms");
+    } else {
+      digitalWrite(control_pins[i], newState); // Pin physisch schalten
+      gpio_states[i] = newState;               // Internen Zustand aktualisieren
+      Serial.print("GPIO ");
+      Serial.print(control_pins[i]);
+      Serial.print(" auf ");
+      Serial.println(newState == HIGH ? "HIGH" : "LOW");
+    }
+  }
+  return targets;
+}
+
+// ----------------------------------------
+// Funktion: handleMessage
+// Verarbeitet eine empfangene Nachricht (vom Broker oder aus der Wiedergabe)
+// ----------------------------------------
+void handleMessage(char* topic, byte* payload, unsigned int length) {
+  // Empfangszeitpunkt so früh wie möglich festhalten (für die Latenz-Messung)
+  uint32_t receivedAt = micros();
+
+  // OTA-Chunks sind binär und kommen in schneller Folge: ohne Debug-Ausgabe
+  // direkt an den Writer übergeben; quittiert wird nur gebündelt (otaChunkStatusDue).
+  if (strcmp(topic, topic_ota_chunk_sub) == 0) {
+    bool accepted = otaAcceptChunk(payload, length);
+    if (otaChunkStatusDue(accepted)) publishOtaStatus(false);
+    return;
+  }
+
+  // RTT-Probe (an sich selbst veröffentlicht): nur Zeitstempel erfassen
+  if (strcmp(topic, topic_link_probe) == 0) {
+    handleLinkProbe(payload, length, receivedAt);
+    return;
+  }
+
+  // Die Debug-Ausgabe blockiert bei vollem UART-Puffer; ihre Dauer wird aus der
+  // Latenz-Messung herausgerechnet
+  uint32_t debugStartedAt = micros();
   Serial.print("Nachricht empfangen auf Topic: [");
   Serial.print(topic);
   Serial.print("] Payload: ");
-  
-  // Konvertiere das Payload (byte array) zu einem String für einfachere Verarbeitung
-  String payloadString = "";
-  for (int i = 0; i < length; i++) {
-    payloadString += (char)payload[i];
-  }
-  Serial.println(payloadString);
+  // Payload direkt ausgeben, ohne es in einen String zu kopieren
+  Serial.write(payload, length);
+  Serial.println();
+  uint32_t debugUs = micros() - debugStartedAt;
+
+  // Hinweis: Das Payload liegt im internen Puffer des PubSubClient. Jeder Handler
+  // parst es vollständig (ArduinoJson kopiert dabei die Strings), bevor er selbst
+  // etwas veröffentlicht und damit diesen Puffer überschreibt.
 
   // Unterscheidung der eingehenden Nachrichten basierend auf dem Topic
   // -------------------------------------------------------------------
 
   // 1. Wenn ein GPIO-Steuerbefehl empfangen wird (z.B. Frontend schaltet Pin)
-  if (String(topic) == topic_gpio_set_sub) {
-    DynamicJsonDocument doc(512); // ArduinoJson Dokument für das Payload
+  //    Gerätespezifisch (gpio/set), flottenweit (esp32/all/gpio/set) oder für eine Gruppe
+  //    (esp32/group/<gruppe>/gpio/set). Alle Varianten verwenden dasselbe Format.
+  const char* impliedGroup = gpioGroupForTopic(topic);
+  bool isFleetCommand = strcmp(topic, GPIO_ALL_SET_TOPIC) == 0 || impliedGroup != nullptr;
+  if (strcmp(topic, topic_gpio_set_sub) == 0 || isFleetCommand) {
+    beginCommandTrace(receivedAt, debugUs); // Trace für diesen Befehl starten
+    JsonDocument doc(&jsonArena); // ArduinoJson Dokument für das Payload
 
     // Versuche, das Payload als JSON zu parsen
-    DeserializationError error = deserializeJson(doc, payloadString);
+    DeserializationError error = deserializeJson(doc, (const byte*)payload, length);
 
     // Fehlerbehandlung beim JSON-Parsen
     if (error) {
       Serial.print(F("JSON-Parsing fehlgeschlagen: "));
       Serial.println(error.f_str());
+      cancelCommandTrace();
       return; // Ungültige JSON-Nachricht, Funktion beenden
     }
 
-    // Iteriere über jedes GPIO-Steuerobjekt im empfangenen JSON-Array
-    // Format: [{"pinNumber": 2, "state": "ON"}, {"pinNumber": 4, "state": "OFF"}]
-    for (JsonObject pinObj : doc.as<JsonArray>()) {
-      // Extrahiere die Pin-Nummer und den Zustand aus dem Objekt
-      if (!pinObj.containsKey("pinNumber") || !pinObj.containsKey("state")) {
-        Serial.println("Fehler: Fehlende Felder 'pinNumber' oder 'state' in GPIO-Befehl");
-        continue; // Diesen Befehl überspringen
-      }
+    // Drei Formate werden unterstützt:
+    // 1. Array: [{"pinNumber": 2, "state": "ON"}, {"group": "lamp", "duty": 40, "fadeMs": 500}]
+    // 2. Objekt mit Korrelations-ID: {"cid": "abc123", "gpios": [{"pinNumber": 2, "state": "ON"}]}
+    //    Die cid wird im GPIO-State-Report zusammen mit den Zeitstempeln zurückgegeben.
+    // 3. Einzelnes Befehlsobjekt: {"label": "Flur", "state": 1} (v.a. für Gruppen-Topics)
+    // Pins werden über "pinNumber", "group" oder "label" ausgewählt.
+    JsonArray commands;
+    const char* cid = nullptr;
+    if (doc.is<JsonArray>()) {
+      commands = doc.as<JsonArray>();
+    } else {
+      cid = doc["cid"].as<const char*>();
+      commands = doc["gpios"].as<JsonArray>();
+    }
+    markCommandParsed(cid);
+
+    // Betroffene Pins vorab auflösen: Flottenbefehle ohne passenden Pin werden still
+    // verworfen, auch bei einer wiederholten Zustellung (kein Report pro Gerät)
+    bool singleCommand = doc.is<JsonObject>() && commands.isNull();
+    uint32_t targetMask = 0;
+    if (singleCommand) {
+      targetMask = resolveGpioTargets(doc.as<JsonObject>(), impliedGroup);
+    }
+    for (JsonObject pinObj : commands) {
+      targetMask |= resolveGpioTargets(pinObj, impliedGroup);
+    }
+    if (isFleetCommand && targetMask == 0) {
+      cancelCommandTrace();
+      return;
+    }
 
-      int pinNum = pinObj["pinNumber"].as<int>();   // Extrahiere die Pin-Nummer
-      String stateStr = pinObj["state"].as<String>(); // Extrahiere den Zustand ("ON", "OFF", "1", "0")
-
-      int newState = LOW; // Standardmäßig LOW
-      // Konvertiere den String-Zustand in HIGH/LOW
-      if (stateStr == "ON" || stateStr == "1" || stateStr == "HIGH") {
-        newState = HIGH;
-      } else if (stateStr == "OFF" || stateStr == "0" || stateStr == "LOW") {
-        newState = LOW;
-      } else {
-        Serial.print("Unbekannter Zustand für Pin ");
-        Serial.print(pinNum);
-        Serial.print(": ");
-        Serial.println(stateStr);
-        continue; // Diesen Pin überspringen und nächsten Pin in der JSON verarbeiten
-      }
+    // Vom Broker wiederholte Zustellung (QoS 1) nicht erneut schalten (z.B. Fade neu starten),
+    // aber den aktuellen Zustand melden, damit der Absender seine Bestätigung erhält.
+    // Erkennung nur über die cid (das Dashboard sendet bei jedem Befehl eine mit)
+    // Trace vorher verwerfen: ohne Schaltzeitpunkt gäbe es keine gültige Zeitmessung
+    if (noteCommandDelivery(cid)) {
+      cancelCommandTrace();
+      reportGpioStates();
+      return;
+    }
 
-      // Suche den Pin im control_pins-Array, um dessen Index zu finden und Zustand zu aktualisieren
-      bool pinFound = false;
-      for (int i = 0; i < NUM_PINS; i++) {
-        if (control_pins[i] == pinNum) {
-          digitalWrite(pinNum, newState); // Pin physisch schalten
-          gpio_states[i] = newState;      // Internen Zustand aktualisieren
-          Serial.print("GPIO ");
-          Serial.print(pinNum);
-          Serial.print(" auf ");
-          Serial.println(newState == HIGH ? "HIGH" : "LOW");
-          pinFound = true;
-          break; // Pin gefunden, Schleife beenden
-        }
-      }
-      if (!pinFound) {
-        Serial.print("Befehl für unbekannten oder nicht steuerbaren Pin empfangen: ");
-        Serial.println(pinNum);
-      }
+    uint32_t switchedMask = 0; // Bit i = control_pins[i] wurde geschaltet
+    if (singleCommand) {
+      switchedMask = applyGpioCommand(doc.as<JsonObject>(), impliedGroup, isFleetCommand);
+    }
+    // Iteriere über jedes GPIO-Steuerobjekt im empfangenen JSON-Array
+    for (JsonObject pinObj : commands) {
+      switchedMask |= applyGpioCommand(pinObj, impliedGroup, isFleetCommand);
+    }
+
+    // Flottenbefehle, die hier nichts geschaltet haben (z.B. ungültiger Zustand), ebenfalls still verwerfen
+    if (isFleetCommand && switchedMask == 0) {
+      cancelCommandTrace();
+      return;
     }
+
+    markCommandActuated();
+    // Aufwachen -> geschaltet (je Energiesparmodus); Wiedergaben auf dem Gerät
+    // kommen nicht aus select() und würden die Fenster verfälschen
+    if (!trafficCapture.replayDispatching) recordWakeToActuation(commandTrace.tActuated);
+
     // Nach der Verarbeitung aller Befehle den aktualisierten GPIO-Status an das Frontend senden
     reportGpioStates();
+    finishCommandTrace(); // Stufen-Dauern in die Statistik übernehmen
   }
   // 2. Wenn eine Status-Anfrage empfangen wird (z.B. vom Frontend beim Laden)
-  else if (String(topic) == topic_status_get_sub || String(topic) == topic_status_get_all_sub) {
+  else if (strcmp(topic, topic_status_get_sub) == 0 || strcmp(topic, topic_status_get_all_sub) == 0) {
     Serial.println("Anfrage empfangen auf /status/get Topic. Sende Status-Daten...");
     sendHeartbeat(); // Sende einen Heartbeat mit aktuellen Statusinformationen
   }
   // 3. Wenn eine WiFi-Scan-Anfrage empfangen wird
-  else if (String(topic) == topic_wifi_get_sub) {
+  else if (strcmp(topic, topic_wifi_get_sub) == 0) {
     Serial.println("Anfrage empfangen auf /wifi/get Topic. Führe WiFi-Scan durch...");
     performWifiScan(); // Führt einen WiFi-Scan durch und sendet die Ergebnisse
   }
   // 4. Wenn eine GPIO-Status-Anfrage empfangen wird
-  else if (String(topic) == topic_gpio_get_sub) {
+  else if (strcmp(topic, topic_gpio_get_sub) == 0) {
     Serial.println("Anfrage empfangen auf /gpio/get Topic. Sende GPIO-Zustände...");
     reportGpioStates(); // Sende den aktuellen Status aller GPIOs
   }
-  else if (String(topic) == topic_settings_get_sub) {
+  else if (strcmp(topic, topic_settings_get_sub) == 0) {
     Serial.println("Anfrage empfangen auf /settings/get Topic. Sende aktuelle Einstellungen...");
     sendDeviceSettings(); // Funktion zum Senden der aktuellen Einstellungen
   }
   // NEU: 6. Wenn ein Befehl zur Einstellung der Geräte-Settings empfangen wird
-  else if (String(topic) == topic_settings_set_sub) {
+  else if (strcmp(topic, topic_settings_set_sub) == 0) {
     Serial.println("Befehl empfangen auf /settings/set Topic. Aktualisiere Einstellungen...");
-    updateDeviceSettings(payloadString); // Funktion zum Aktualisieren der Einstellungen
+    updateDeviceSettings(payload, length); // Funktion zum Aktualisieren der Einstellungen
+  }
+  // 7. Ping für die Round-Trip-Messung (Dashboard -> ESP32 -> Dashboard)
+  else if (strcmp(topic, topic_ping_sub) == 0) {
+    handlePing(payload, length, receivedAt);
+  }
+  // 8. Anfrage für die Latenz-Statistik
+  else if (strcmp(topic, topic_latency_get_sub) == 0) {
+    Serial.println("Anfrage empfangen auf /latency/get Topic. Sende Latenz-Statistik...");
+    sendLatencyStats();
+  }
+  // 9. Start (oder Fortsetzung) eines Firmware-Updates
+  else if (strcmp(topic, topic_ota_begin_sub) == 0) {
+    Serial.println("Befehl empfangen auf /ota/begin Topic. Starte Firmware-Update...");
+    handleOtaBegin(payload, length);
+  }
+  // 10. Abbruch eines Firmware-Updates
+  else if (strcmp(topic, topic_ota_abort_sub) == 0) {
+    Serial.println("Befehl empfangen auf /ota/abort Topic. Breche Firmware-Update ab...");
+    otaAbort();
+    publishOtaStatus(true);
+  }
+  // 11. Aufzeichnung/Wiedergabe des MQTT-Verkehrs steuern
+  else if (strcmp(topic, topic_capture_cmd_sub) == 0) {
+    Serial.println("Befehl empfangen auf /capture/cmd Topic.");
+    handleCaptureCommand(payload, length);
   }
   // Für alle anderen Topics, die abonniert sind, aber nicht explizit behandelt werden
   else {
@@ -274,6 +608,59 @@ void callback(char* topic, byte* payload, unsigned int length) {
   }
 }
 
+// ----------------------------------------
+// Funktion: handlerCategory
+// Ordnet ein Topic der Kategorie im Handler-Profil zu. HANDLER_NONE für
+// Nachrichten, die weder profiliert noch aufgezeichnet werden: OTA (Flash-
+// Schreiben), RTT-Probe und die Capture-Steuerung.
+// ----------------------------------------
+HandlerCategory handlerCategory(const char* topic) {
+  if (strcmp(topic, topic_gpio_set_sub) == 0 || strcmp(topic, GPIO_ALL_SET_TOPIC) == 0 ||
+      gpioGroupForTopic(topic) != nullptr) return HANDLER_GPIO_SET;
+  if (strcmp(topic, topic_status_get_sub) == 0 || strcmp(topic, topic_status_get_all_sub) == 0) return HANDLER_STATUS_GET;
+  if (strcmp(topic, topic_wifi_get_sub) == 0) return HANDLER_WIFI_GET;
+  if (strcmp(topic, topic_gpio_get_sub) == 0) return HANDLER_GPIO_GET;
+  if (strcmp(topic, topic_settings_get_sub) == 0) return HANDLER_SETTINGS_GET;
+  if (strcmp(topic, topic_settings_set_sub) == 0) return HANDLER_SETTINGS_SET;
+  if (strcmp(topic, topic_ping_sub) == 0) return HANDLER_PING;
+  if (strcmp(topic, topic_latency_get_sub) == 0) return HANDLER_LATENCY_GET;
+
+  if (strcmp(topic, topic_ota_chunk_sub) == 0 || strcmp(topic, topic_ota_begin_sub) == 0 ||
+      strcmp(topic, topic_ota_abort_sub) == 0 || strcmp(topic, topic_link_probe) == 0 ||
+      strcmp(topic, topic_capture_cmd_sub) == 0) {
+    return HANDLER_NONE;
+  }
+  return HANDLER_OTHER;
+}
+
+// ----------------------------------------
+// Funktion: MQTT Callback
+// Wird aufgerufen, wenn eine Nachricht auf einem abonnierten Topic empfangen wird
+// (bzw. von der Wiedergabe in captureReplayPoll()). Zeichnet die Nachricht
+// ggf. auf und misst Laufzeit und Speicherverbrauch des Handlers.
+// ----------------------------------------
+void callback(char* topic, byte* payload, unsigned int length) {
+  HandlerCategory category = handlerCategory(topic);
+  if (category == HANDLER_NONE) {
+    handleMessage(topic, payload, length);
+    return;
+  }
+
+  // Vor dem Handler aufzeichnen: Antworten überschreiben den Puffer des PubSubClient
+  captureMessage(topic, payload, length);
+
+  // Während einer Wiedergabe auf dem Gerät nur die abgespielten Nachrichten
+  // profilieren; gleichzeitig eintreffende Live-Nachrichten verfälschen sonst den Vergleich
+  if (trafficCapture.replaying && !trafficCapture.replayDispatching) {
+    handleMessage(topic, payload, length);
+    return;
+  }
+
+  beginHandlerProfile();
+  handleMessage(topic, payload, length);
+  endHandlerProfile(category);
+}
+
 // ----------------------------------------
 // Funktion: setup_wifi
 // Verbindet den ESP32 mit dem konfigurierten WLAN-Netzwerk
@@ -293,6 +680,7 @@ void setup_wifi() {
   while (WiFi.status() != WL_CONNECTED) {
     delay(500);
     Serial.print(".");
+    otaCheckBootDeadline(); // Neues Image ohne WLAN (z.B. defekter Treiber) -> Rollback
   }
 
   Serial.println("");
@@ -304,40 +692,48 @@ void setup_wifi() {
 // ----------------------------------------
 // Funktion: reconnect_mqtt
 // Stellt die Verbindung zum MQTT-Broker her oder wieder her.
-// Abonniert alle notwendigen Topics nach erfolgreicher Verbindung.
+// Verwendet eine persistente Session (cleanSession=false): Der Broker behält die
+// Subscriptions und reiht QoS-1-Befehle ein, solange das Gerät offline ist.
 // ----------------------------------------
 void reconnect_mqtt() {
+  markMqttReconnectStart();
+
   // Schleife, solange keine Verbindung zum Broker besteht
   while (!client.connected()) {
     Serial.print("Versuche MQTT-Verbindung...");
 
     // Versuche, eine Verbindung zum MQTT-Broker herzustellen
-    if (client.connect(
-          deviceId.c_str(),         // Client-ID (eindeutige Geräte-ID)
+    uint32_t attemptStart = millis();
+    bool connected = client.connect(
+          deviceId,                 // Client-ID (eindeutige Geräte-ID, identifiziert die Session)
           mqtt_user,                // MQTT-Benutzername
           mqtt_pass,                // MQTT-Passwort
-          topic_status_pub.c_str(), // willTopic
+          topic_status_pub,         // willTopic
           0,                        // willQoS
           true,                     // willRetain
-          "{\"status\":\"offline\"}" // willMessage
-          )
-        )
-      {
+          "{\"status\":\"offline\"}", // willMessage
+          false                     // cleanSession: Session beim Broker erhalten
+          );
+    markMqttConnectAttempt(connected, millis() - attemptStart);
+
+    if (connected) {
       Serial.println("verbunden!");
 
-      // Sende sofort nach dem Connect eine "online"-Statusnachricht (LWT wird überschrieben)
+      // Befehls-Topics mit QoS 1 (werden bei kurzen Verbindungsabbrüchen vom Broker
+      // eingereiht). Bei einer fortgesetzten Session sind die Subscriptions bereits
+      // vorhanden; das erneute Abonnieren ist dann ein günstiger No-Op.
+      // PubSubClient meldet nicht, ob die Session fortgesetzt wurde.
+      subscribeCommandTopics();                     // Befehle an dieses Gerät und an alle Geräte
+      subscribeGroupTopics(true);                   // Abonnieren für GPIO-Befehle an die eigenen Gruppen
+      markMqttReady();
+
+      // Sende nach dem Connect eine "online"-Statusnachricht (LWT wird überschrieben)
       sendHeartbeat(); // sendHeartbeat() sendet die "online" Statusnachricht
 
-      // WICHTIG: Hier alle Topics abonnieren, die dieser ESP32 empfangen soll.
-      // Diese Subscriptions gehen verloren, wenn die Verbindung abbricht und müssen
-      // bei jedem Reconnect erneuert werden.
-      client.subscribe(topic_gpio_set_sub.c_str());     // Abonnieren für GPIO-Steuerbefehle
-      client.subscribe(topic_status_get_sub.c_str());   // Abonnieren für Status-Anfragen
-      client.subscribe(topic_status_get_all_sub.c_str()); // Abonnieren für Status-Anfragen aller Geräte
-      client.subscribe(topic_wifi_get_sub.c_str());     // Abonnieren für WiFi-Scan-Anfragen
-      client.subscribe(topic_gpio_get_sub.c_str());     // Abonnieren für GPIO-Status-Anfragen
-      client.subscribe(topic_settings_get_sub.c_str()); // Abonnieren für Settings-Anfragen
-      client.subscribe(topic_settings_set_sub.c_str()); // Abonnieren für Setting-Änderungsbefehle
+      // Ein frisch installiertes Image hat sich erfolgreich verbunden -> bestätigen
+      otaConfirmBoot();
+      // OTA-Status (retained) senden, damit ein Absender ein unterbrochenes Update fortsetzen kann
+      publishOtaStatus(true);
 
       // Initialen GPIO-Status senden (für Dashboard-Initialisierung)
       reportGpioStates();
@@ -346,6 +742,7 @@ void reconnect_mqtt() {
       Serial.print("Fehlgeschlagen, rc=");
       Serial.print(client.state()); // Zeigt den Fehlercode des MQTT-Clients
       Serial.println(" -> Erneuter Versuch in 5 Sekunden");
+      otaCheckBootDeadline(); // Neues Image ohne Verbindung -> Rollback
       delay(5000); // 5 Sekunden warten, bevor erneut versucht wird
     }
   }
@@ -359,35 +756,54 @@ void sendHeartbeat() {
   Serial.println("Sende Heartbeat...");
   lastHeartbeatTime = millis(); // Aktualisiert den Zeitpunkt des letzten Heartbeats
 
-  DynamicJsonDocument doc(512); // ArduinoJson Dokument für den Heartbeat-Payload (512 Bytes für mehr Puffer)
+  sampleHeap(); // Heap-/Fragmentierungs-Messung mit jedem Heartbeat
+
+  JsonDocument doc(&jsonArena); // ArduinoJson Dokument für den Heartbeat-Payload
+
+  // SSID/RSSI direkt aus dem WiFi-Treiber lesen (WiFi.SSID() würde einen String erzeugen)
+  wifi_ap_record_t apInfo;
+  bool apInfoValid = esp_wifi_sta_get_ap_info(&apInfo) == ESP_OK;
 
   doc["status"] = "online";      // Status des Geräts
-  doc["wifi"] = WiFi.SSID();     // Aktuell verbundenes WLAN-SSID
-  doc["rssi"] = WiFi.RSSI();     // Signalstärke des verbundenen WLANs
+  doc["wifi"] = apInfoValid ? (const char*)apInfo.ssid : ""; // Aktuell verbundenes WLAN-SSID
+  doc["rssi"] = apInfoValid ? apInfo.rssi : 0;                // Signalstärke des verbundenen WLANs
   doc["uptime"] = millis() / 1000; // Uptime in Sekunden
   doc["deviceName"] = currentDeviceName; // Name des Geräts
 
   // Erstellt das GPIO-States-Array im neuen Format
-  JsonArray gpio_states_json = doc.createNestedArray("gpioStates");
+  JsonArray gpio_states_json = doc["gpioStates"].to<JsonArray>();
 
   // Fügt den Status jedes Pins als Objekt zum JSON-Array hinzu
   for (int i = 0; i < NUM_PINS; i++) {
-    JsonObject pinObj = gpio_states_json.createNestedObject();
+    JsonObject pinObj = gpio_states_json.add<JsonObject>();
     pinObj["pinNumber"] = control_pins[i];
     pinObj["state"] = gpio_states[i];
     // Metadaten (group / label)
     pinObj["group"] = gpioConfigs[i].group;
     pinObj["label"] = gpioConfigs[i].label;
+    pwmStateToJson(i, pinObj); // Modus und ggf. Tastverhältnis
   }
 
-  String payload;
-  serializeJson(doc, payload); // Serialisiert das JSON-Dokument in einen String
+  // Heap-Kennzahlen (freier Heap, größter Block, JSON-Arena)
+  heapStatsToJson(doc["heap"].to<JsonObject>());
+  // Energiesparmodus, Aktivanteil und Aufwach-Latenz
+  powerStatsToJson(doc["power"].to<JsonObject>());
+#if MQTT_USE_TLS
+  // TLS-Handshakes: voll vs. wiederaufgenommen, Dauer
+  tlsStatsToJson(doc["tls"].to<JsonObject>());
+#endif
+  // Reconnects, Zeit bis zur Bereitschaft, eingereihte/wiederholte Befehle
+  mqttSessionStatsToJson(doc["mqtt"].to<JsonObject>());
+  // Link-Qualität: nur Aggregate (min/max/mean/p95) der letzten Messungen
+  linkStatsToJson(doc["link"].to<JsonObject>());
+
+  if (serializePayload(doc) == 0) return; // Serialisiert das JSON-Dokument in den Sendepuffer
 
   Serial.print("Heartbeat Payload: ");
-  Serial.println(payload);
+  Serial.println(mqttPayload);
 
   if (client.connected()) {
-    client.publish(topic_status_pub.c_str(), payload.c_str(), true); // Veröffentlicht die Nachricht (retained = true)
+    mqttPublish(topic_status_pub, mqttPayload, true); // Veröffentlicht die Nachricht (retained = true)
   } else {
     Serial.println("MQTT Client ist NICHT verbunden, Heartbeat nicht gesendet.");
   }
@@ -431,36 +847,40 @@ void processWifiScanResults(int n) {
     Serial.print("Keine Netzwerke gefunden oder Fehler beim Scan: ");
     Serial.println(n);
     if (client.connected()) {
-      client.publish(topic_wifi_scan_pub.c_str(), "{\"networks\":[]}"); // Sende leeres JSON-Array
+      mqttPublish(topic_wifi_scan_pub, "{\"networks\":[]}"); // Sende leeres JSON-Array
     } else {
       Serial.println("MQTT Client ist NICHT verbunden, WiFi Scan nicht gesendet.");
     }
   } else {
-    // DynamicJsonDocument mit ausreichender Kapazität für Scan-Ergebnisse
-    // 2048 Bytes sind eine gute Schätzung für bis zu 15-20 Netzwerke.
-    DynamicJsonDocument doc(2048); 
+    // JsonDocument aus der statischen Arena (ausreichend für bis zu 15-20 Netzwerke;
+    // größere Ergebnisse passen ohnehin nicht in den MQTT-Puffer von 2048 Bytes)
+    JsonDocument doc(&jsonArena);
 
     JsonObject root = doc.to<JsonObject>();            // Erstellt das Wurzelobjekt des JSON
-    JsonArray networks = root.createNestedArray("networks"); // Erstellt ein Array für die Netzwerke
+    JsonArray networks = root["networks"].to<JsonArray>(); // Erstellt ein Array für die Netzwerke
 
     // Fügt jedes gefundene Netzwerk als Objekt zum JSON-Array hinzu
     for (int i = 0; i < n; ++i) {
-      JsonObject network = networks.createNestedObject();
-      network["ssid"] = WiFi.SSID(i);         // SSID des Netzwerks
-      network["rssi"] = WiFi.RSSI(i);         // Signalstärke
-      network["encryption"] = WiFi.encryptionType(i); // Verschlüsselungstyp (als Zahl)
+      // Scan-Eintrag direkt aus dem Treiber lesen (WiFi.SSID(i) würde einen String erzeugen)
+      wifi_ap_record_t* ap = (wifi_ap_record_t*)WiFi.getScanInfoByIndex(i);
+      if (ap == nullptr) continue;
+      JsonObject network = networks.add<JsonObject>();
+      network["ssid"] = (const char*)ap->ssid; // SSID des Netzwerks
+      network["rssi"] = ap->rssi;              // Signalstärke
+      network["encryption"] = ap->authmode;    // Verschlüsselungstyp (als Zahl)
     }
 
-    String json_output;
-    serializeJson(doc, json_output); // Serialisiert das JSON-Dokument in einen String
+    size_t json_length = serializePayload(doc); // Serialisiert das JSON-Dokument in den Sendepuffer
 
     Serial.print("Heap nach JSON-Erstellung: "); Serial.println(ESP.getFreeHeap()); // Debug-Ausgabe des freien Heaps
-    Serial.print("Größe der JSON-Nachricht: "); Serial.print(json_output.length()); // Debug-Ausgabe der Nachrichtengröße
+    Serial.print("Größe der JSON-Nachricht: "); Serial.print(json_length); // Debug-Ausgabe der Nachrichtengröße
     Serial.println(" Bytes");
 
-    if (client.connected()) {
+    if (json_length == 0) {
+      Serial.println("WiFi Scan zu groß, nicht gesendet.");
+    } else if (client.connected()) {
       Serial.println("MQTT Client ist verbunden, sende WiFi Scan.");
-      client.publish(topic_wifi_scan_pub.c_str(), json_output.c_str()); // Veröffentlicht die Nachricht
+      mqttPublish(topic_wifi_scan_pub, mqttPayload); // Veröffentlicht die Nachricht
     } else {
       Serial.println("MQTT Client ist NICHT verbunden, WiFi Scan nicht gesendet.");
     }
@@ -475,31 +895,208 @@ void processWifiScanResults(int n) {
 // Sendet den aktuellen Status aller konfigurierten GPIO-Pins als JSON.
 // ----------------------------------------
 void reportGpioStates() {
-  // Dynamisches JSON-Dokument für GPIO-Zustände (256 Bytes sind ausreichend)
-  DynamicJsonDocument doc(256);
+  // JSON-Dokument für GPIO-Zustände (Speicher aus der statischen Arena)
+  JsonDocument doc(&jsonArena);
   JsonObject root = doc.to<JsonObject>(); // Erstellt das Wurzelobjekt
-  JsonArray gpio_states_json = root.createNestedArray("gpioStates");
+  JsonArray gpio_states_json = root["gpioStates"].to<JsonArray>();
 
   // Fügt den Status jedes Pins als Objekt zum JSON-Array hinzu
   for (int i = 0; i < NUM_PINS; i++) {
-    JsonObject pinObj = gpio_states_json.createNestedObject();
+    JsonObject pinObj = gpio_states_json.add<JsonObject>();
     pinObj["pinNumber"] = control_pins[i];
     pinObj["state"] = gpio_states[i];
     pinObj["group"] = gpioConfigs[i].group;
     pinObj["label"] = gpioConfigs[i].label;
+    pwmStateToJson(i, pinObj);
   }
 
-  String payload;
-  serializeJson(doc, payload); // Serialisiert das JSON-Dokument in einen String
+  // Wenn der Report durch einen gpio/set-Befehl ausgelöst wurde: cid + Zeitstempel anhängen
+  appendCommandTiming(root);
 
-  Serial.print("Sende GPIO-Zustände: ");
-  Serial.println(payload);
+  if (serializePayload(doc) == 0) return; // Serialisiert das JSON-Dokument in den Sendepuffer
+  markCommandSerialized();
 
   if (client.connected()) {
-    client.publish(topic_gpio_state_pub.c_str(), payload.c_str()); // Veröffentlicht die Nachricht
+    mqttPublish(topic_gpio_state_pub, mqttPayload); // Veröffentlicht die Nachricht
+    markCommandPublished();
   } else {
     Serial.println("MQTT Client ist NICHT verbunden, GPIO-Zustände nicht gesendet.");
   }
+
+  // Debug-Ausgabe erst nach dem Publish (nicht Teil der Latenz-Messung);
+  // client.publish() hat den Sendepuffer bereits kopiert
+  Serial.print("Sende GPIO-Zustände: ");
+  Serial.println(mqttPayload);
+}
+
+// ----------------------------------------
+// Funktion: handlePing
+// Beantwortet einen Ping mit einem Pong. Die Felder "id" und "t" der Anfrage
+// werden unverändert zurückgegeben, damit der Absender die Round-Trip-Zeit
+// berechnen kann. "rx"/"tx" sind die Zeitstempel des Geräts (µs seit Boot),
+// so lässt sich die Verarbeitungszeit auf dem Gerät herausrechnen.
+// ----------------------------------------
+void handlePing(const byte* payload, unsigned int length, uint32_t receivedAt) {
+  JsonDocument request(&jsonArena);
+  JsonDocument doc(&jsonArena);
+
+  // Ein leeres oder ungültiges Payload ist erlaubt (dann ohne id/t)
+  if (!deserializeJson(request, payload, length)) {
+    doc["id"] = request["id"];
+    doc["t"] = request["t"];
+  }
+  doc["rx"] = receivedAt;
+  doc["tx"] = micros();
+
+  if (serializePayload(doc) == 0) return;
+
+  if (client.connected()) {
+    mqttPublish(topic_pong_pub, mqttPayload);
+  } else {
+    Serial.println("MQTT Client ist NICHT verbunden, Pong nicht gesendet.");
+  }
+
+  latencyStats.ping.add(micros() - receivedAt);
+}
+
+// ----------------------------------------
+// Funktion: sendLatencyStats
+// Sendet die auf dem Gerät gesammelten Latenz-Perzentile pro Stufe.
+// ----------------------------------------
+void sendLatencyStats() {
+  JsonDocument doc(&jsonArena);
+  latencyStatsToJson(doc.to<JsonObject>());
+
+  if (serializePayload(doc) == 0) return;
+
+  Serial.print("Sende Latenz-Statistik: ");
+  Serial.println(mqttPayload);
+
+  if (client.connected()) {
+    mqttPublish(topic_latency_pub, mqttPayload);
+  } else {
+    Serial.println("MQTT Client ist NICHT verbunden, Latenz-Statistik nicht gesendet.");
+  }
+}
+
+// ----------------------------------------
+// Funktion: handleOtaBegin
+// Startet ein Firmware-Update.
+// Payload: {"size": 912345, "sha256": "<hex>", "hmac": "<HMAC-SHA256(Secret, sha256) hex>"}
+// Der Absender liest anschließend "offset" aus ota/status und sendet ab dort.
+// ----------------------------------------
+void handleOtaBegin(const byte* payload, unsigned int length) {
+  JsonDocument doc(&jsonArena);
+  DeserializationError error = deserializeJson(doc, payload, length);
+  if (error) {
+    Serial.print(F("JSON-Parsing für OTA fehlgeschlagen: "));
+    Serial.println(error.f_str());
+    return;
+  }
+
+  otaBegin(doc["size"] | 0u, doc["sha256"].as<const char*>(), doc["hmac"].as<const char*>());
+  publishOtaStatus(true);
+}
+
+// ----------------------------------------
+// Funktion: publishOtaStatus
+// Sendet den OTA-Status. Zustandswechsel werden retained gesendet,
+// die (gebündelten) Chunk-Quittungen nicht.
+// ----------------------------------------
+void publishOtaStatus(bool retained) {
+  JsonDocument doc(&jsonArena);
+  otaStatusToJson(doc.to<JsonObject>());
+
+  if (serializePayload(doc) == 0) return;
+
+  if (client.connected()) {
+    mqttPublish(topic_ota_status_pub, mqttPayload, retained);
+  }
+}
+
+// ----------------------------------------
+// Funktion: handleCaptureCommand
+// Steuert Aufzeichnung, Export und Wiedergabe. Payload: {"cmd": "<befehl>", ...}
+// - start:   Aufzeichnung neu beginnen (verwirft die bisherige)
+// - stop:    Aufzeichnung beenden
+// - status:  Zustand melden
+// - export:  Aufzeichnung in Chunks auf capture/data/chunk senden
+// - replay:  {"speed": 1.0, "settings": false} Aufzeichnung in den Callback einspielen
+// - profile: {"reset": false} Handler-Profil melden (und danach zurücksetzen)
+// ----------------------------------------
+void handleCaptureCommand(const byte* payload, unsigned int length) {
+  JsonDocument doc(&jsonArena);
+  DeserializationError error = deserializeJson(doc, payload, length);
+  if (error) {
+    Serial.print(F("JSON-Parsing für Capture fehlgeschlagen: "));
+    Serial.println(error.f_str());
+    return;
+  }
+
+  const char* cmd = doc["cmd"] | "";
+  if (strcmp(cmd, "start") == 0) {
+    if (!captureStart()) {
+      publishCaptureStatus(false, "busy");
+      return;
+    }
+  } else if (strcmp(cmd, "stop") == 0) {
+    captureStop();
+  } else if (strcmp(cmd, "export") == 0) {
+    if (!captureStartExport()) {
+      publishCaptureStatus(false, "busy");
+      return;
+    }
+  } else if (strcmp(cmd, "replay") == 0) {
+    // Profil und gemerkte Korrelations-IDs gelten ab jetzt nur für die Wiedergabe
+    resetHandlerProfile();
+    forgetRecentCommands();
+    if (!captureStartReplay(doc["speed"] | 1.0f, doc["settings"] | false)) {
+      publishCaptureStatus(false, "empty or busy");
+      return;
+    }
+  } else if (strcmp(cmd, "profile") == 0) {
+    publishCaptureStatus(true);
+    if (doc["reset"] | false) resetHandlerProfile();
+    return;
+  } else if (strcmp(cmd, "status") != 0) {
+    publishCaptureStatus(false, "unknown cmd");
+    return;
+  }
+  publishCaptureStatus(false);
+}
+
+// ----------------------------------------
+// Funktion: publishCaptureStatus
+// Sendet den Capture-Status, optional mit dem Handler-Profil
+// ----------------------------------------
+void publishCaptureStatus(bool withProfile, const char* error) {
+  JsonDocument doc(&jsonArena);
+  captureStatusToJson(doc.to<JsonObject>());
+  if (error != nullptr) doc["error"] = error;
+  if (withProfile) handlerProfileToJson(doc["profile"].to<JsonObject>());
+
+  if (serializePayload(doc) == 0) return;
+
+  if (client.connected()) {
+    mqttPublish(topic_capture_pub, mqttPayload);
+  }
+}
+
+// ----------------------------------------
+// Funktion: publishCaptureChunk
+// Sendet den nächsten Export-Chunk (ein Chunk pro loop()-Durchlauf).
+// mqttPayload dient als Sendepuffer; schlägt der Publish fehl, wird der
+// Chunk im nächsten Durchlauf wiederholt.
+// ----------------------------------------
+void publishCaptureChunk() {
+  size_t dataLen = 0;
+  size_t chunkLen = captureNextExportChunk((uint8_t*)mqttPayload, CAPTURE_EXPORT_HEADER_LEN + CAPTURE_EXPORT_CHUNK, &dataLen);
+  if (!mqttPublish(topic_capture_data_pub, (const uint8_t*)mqttPayload, chunkLen)) return;
+
+  if (captureExportAdvance(dataLen)) {
+    Serial.println("Capture-Export abgeschlossen");
+    publishCaptureStatus(false);
+  }
 }
 
 // ----------------------------------------
@@ -522,9 +1119,12 @@ void setup() {
     }
   }
   
+  // OTA: Writer-Task anlegen und ggf. ein neues Image zur Bestätigung vormerken
+  initOta();
+
   // Aktualisiere die lokalen Variablen mit geladenen Einstellungen
   wifiScanInterval = deviceSettings.wifiScanInterval;
-  currentDeviceName = deviceSettings.deviceName;
+  strlcpy(currentDeviceName, deviceSettings.deviceName, sizeof(currentDeviceName));
   
   // Debug-Ausgabe der geladenen Settings
   printSettings();
@@ -548,8 +1148,9 @@ void setup() {
     GPIOConfig temp[NUM_PINS];
     for (int i = 0; i < NUM_PINS; i++) {
       temp[i].pinNumber = control_pins[i];
-      temp[i].group = "none";
-      temp[i].label = "";
+      strlcpy(temp[i].group, "none", sizeof(temp[i].group));
+      temp[i].label[0] = '\0';
+      strlcpy(temp[i].mode, "digital", sizeof(temp[i].mode));
     }
     // Übernehme geladene configs (falls vorhanden) basierend auf pinNumber
     for (int j = 0; j < NUM_PINS; j++) {
@@ -566,6 +1167,14 @@ void setup() {
     for (int i = 0; i < NUM_PINS; i++) gpioConfigs[i] = temp[i];
   }
 
+  // Gruppen-Index für Flottenbefehle aus der Konfiguration aufbauen
+  rebuildGpioIndex();
+
+  // PWM-Pins an ihren LEDC-Kanal binden (digitale Pins bleiben unverändert)
+  for (int i = 0; i < NUM_PINS; i++) {
+    if (isPwmPin(i)) configureOutput(i);
+  }
+
   // --- Generiere die eindeutige Device ID ---
   // Initialisiere WiFi im STA-Modus, um die MAC-Adresse auslesen zu können
   WiFi.mode(WIFI_STA);
@@ -576,49 +1185,138 @@ void setup() {
   WiFi.macAddress(mac);
 
   // Formatiert die MAC-Adresse in einen 12-stelligen Hex-String ohne Trennzeichen
-  char macStr[18]; // Puffer für "XXXXXXXXXXXX\0" (13 Zeichen)
-  sprintf(macStr, "%02X%02X%02X%02X%02X%02X", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
-
-  deviceId = String(macStr);
+  // Puffer für "XXXXXXXXXXXX\0" (13 Zeichen)
+  snprintf(deviceId, sizeof(deviceId), "%02X%02X%02X%02X%02X%02X", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
   Serial.print("Generated Device ID: "); Serial.println(deviceId);
   // --- Ende Generierung ---
 
   // --- MQTT Topics initialisieren ---
-  topic_status_get_all_sub = "esp32/all/status/get"; // Gemeinsames Topic für alle Geräte
+  strlcpy(topic_status_get_all_sub, "esp32/all/status/get", TOPIC_MAX_LEN); // Gemeinsames Topic für alle Geräte
+  strlcpy(topic_broadcast_sub, "esp32/all/+/+", TOPIC_MAX_LEN);
+  buildTopic(topic_device_sub, "+/+");
   // Alle Topics basieren auf der generierten eindeutigen deviceId
-  topic_status_pub = "esp32/" + deviceId + "/status";
-  topic_wifi_scan_pub = "esp32/" + deviceId + "/wifi/scan";
-  topic_gpio_state_pub = "esp32/" + deviceId + "/gpio/state";
-  topic_gpio_set_sub = "esp32/" + deviceId + "/gpio/set";
+  buildTopic(topic_status_pub, "status");
+  buildTopic(topic_wifi_scan_pub, "wifi/scan");
+  buildTopic(topic_gpio_state_pub, "gpio/state");
+  buildTopic(topic_gpio_set_sub, "gpio/set");
   // Topics für spezifische Anfragen vom Frontend
-  topic_status_get_sub = "esp32/" + deviceId + "/status/get";
-  topic_wifi_get_sub = "esp32/" + deviceId + "/wifi/get";
-  topic_gpio_get_sub = "esp32/" + deviceId + "/gpio/get";
+  buildTopic(topic_status_get_sub, "status/get");
+  buildTopic(topic_wifi_get_sub, "wifi/get");
+  buildTopic(topic_gpio_get_sub, "gpio/get");
   // Topics für Geräteeinstellungen
-  topic_settings_get_sub = "esp32/" + deviceId + "/settings/get";
-  topic_settings_pub = "esp32/" + deviceId + "/settings";
-  topic_settings_set_sub = "esp32/" + deviceId + "/settings/set";
+  buildTopic(topic_settings_get_sub, "settings/get");
+  buildTopic(topic_settings_pub, "settings");
+  buildTopic(topic_settings_set_sub, "settings/set");
+  // Topics für die Latenz-Messung
+  buildTopic(topic_latency_get_sub, "latency/get");
+  buildTopic(topic_latency_pub, "latency");
+  buildTopic(topic_ping_sub, "latency/ping");
+  buildTopic(topic_pong_pub, "latency/pong");
+  // Topics für das Firmware-Update
+  buildTopic(topic_ota_begin_sub, "ota/begin");
+  buildTopic(topic_ota_chunk_sub, "ota/chunk");
+  buildTopic(topic_ota_abort_sub, "ota/abort");
+  buildTopic(topic_ota_status_pub, "ota/status");
+
+  buildTopic(topic_link_probe, "link/probe");
+  // Topics für Aufzeichnung/Wiedergabe. Status und Export haben eine bzw. drei
+  // Ebenen und kommen daher nicht über die eigene Wildcard (+/+) zurück.
+  buildTopic(topic_capture_cmd_sub, "capture/cmd");
+  buildTopic(topic_capture_pub, "capture");
+  buildTopic(topic_capture_data_pub, "capture/data/chunk");
 
   // Debug-Ausgabe der generierten Topics zur Überprüfung
   Serial.print("MQTT Topic Heartbeat: "); Serial.println(topic_status_pub);
   Serial.print("MQTT Topic WiFi Scan: "); Serial.println(topic_wifi_scan_pub);
   Serial.print("MQTT Topic GPIO State: "); Serial.println(topic_gpio_state_pub);
   Serial.print("MQTT Topic GPIO Set (Sub): "); Serial.println(topic_gpio_set_sub);
+  Serial.print("MQTT Topic GPIO Set Flotte (Sub): "); Serial.println(GPIO_ALL_SET_TOPIC);
   Serial.print("MQTT Topic Status Get (Sub): "); Serial.println(topic_status_get_sub);
   Serial.print("MQTT Topic WiFi Get (Sub): "); Serial.println(topic_wifi_get_sub);
   Serial.print("MQTT Topic GPIO Get (Sub): "); Serial.println(topic_gpio_get_sub);
   Serial.print("MQTT Topic Settings Get (Sub): "); Serial.println(topic_settings_get_sub);
   Serial.print("MQTT Topic Settings Publish: "); Serial.println(topic_settings_pub);
   Serial.print("MQTT Topic Settings Set (Sub): "); Serial.println(topic_settings_set_sub);
+  Serial.print("MQTT Topic Latency Get (Sub): "); Serial.println(topic_latency_get_sub);
+  Serial.print("MQTT Topic Latency Publish: "); Serial.println(topic_latency_pub);
+  Serial.print("MQTT Topic Ping (Sub): "); Serial.println(topic_ping_sub);
+  Serial.print("MQTT Topic Pong Publish: "); Serial.println(topic_pong_pub);
+  Serial.print("MQTT Topic OTA Begin (Sub): "); Serial.println(topic_ota_begin_sub);
+  Serial.print("MQTT Topic OTA Chunk (Sub): "); Serial.println(topic_ota_chunk_sub);
+  Serial.print("MQTT Topic OTA Abort (Sub): "); Serial.println(topic_ota_abort_sub);
+  Serial.print("MQTT Topic OTA Status Publish: "); Serial.println(topic_ota_status_pub);
+  Serial.print("MQTT Topic Capture Cmd (Sub): "); Serial.println(topic_capture_cmd_sub);
+  Serial.print("MQTT Topic Capture Publish: "); Serial.println(topic_capture_pub);
   // --- Ende Topics Initialisierung ---
 
+  // Aufzeichnung vom letzten Boot für Export/Wiedergabe übernehmen
+  initTrafficCapture(deviceId);
+
 
+  initLinkQuality(deviceSettings.linkSampleInterval); // Vor dem WLAN-Start, um Abbrüche zu zählen
+  otaCheckBootDeadline(); // Frist eines neuen Images schon vor dem Warten auf WLAN prüfen
   setup_wifi(); // Stellt die WLAN-Verbindung her
 
   // MQTT-Client konfigurieren
   client.setServer(mqtt_broker, mqtt_port); // Setzt die Broker-Adresse
   client.setCallback(callback);             // Registriert die Callback-Funktion für eingehende Nachrichten
   client.setBufferSize(2048);               // Erhöht den internen MQTT-Puffer für größere Payloads
+#if MQTT_USE_TLS
+  espClient.setCACert(MQTT_CA_CERT);
+  espClient.setTimeout(TLS_CONNECT_TIMEOUT_S);    // Obergrenze für den TCP-Verbindungsaufbau
+  espClient.loadSession(mqtt_broker, mqtt_port); // Session vom letzten Boot -> verkürzter erster Handshake
+#endif
+
+  // Ereignisgesteuerte Hauptschleife vorbereiten und Energiesparmodus aktivieren
+  initPowerManager(deviceSettings.powerMode);
+}
+
+// ----------------------------------------
+// Funktion: mqttSocketFd
+// Socket der MQTT-Verbindung für select() (-1 = keine Verbindung)
+// ----------------------------------------
+int mqttSocketFd() {
+  if (!client.connected()) return -1;
+#if MQTT_USE_TLS
+  return espClient.socketFd();
+#else
+  return espClient.fd();
+#endif
+}
+
+// ----------------------------------------
+// Funktion: millisUntilNextTask
+// Berechnet, wie lange die Hauptschleife schlafen darf, bis der nächste
+// Heartbeat, WiFi-Scan, Link-Messung, Capture-Schritt oder MQTT-Keep-Alive fällig ist.
+// ----------------------------------------
+uint32_t millisUntilNextTask() {
+  unsigned long now = millis();
+
+  // client.loop() muss spätestens zur Hälfte des Keep-Alive-Intervalls laufen
+  uint32_t wait = (uint32_t)MQTT_KEEPALIVE * 1000 / 2;
+
+  unsigned long sinceHeartbeat = now - lastHeartbeatTime;
+  uint32_t untilHeartbeat = sinceHeartbeat >= (unsigned long)heartbeatInterval ? 0 : heartbeatInterval - sinceHeartbeat;
+  if (untilHeartbeat < wait) wait = untilHeartbeat;
+
+  // Während eines Scans weckt das Scan-Done-Event die Schleife auf
+  if (!wifiScanning) {
+    unsigned long sinceScan = now - lastWifiScanTime;
+    uint32_t untilScan = sinceScan >= (unsigned long)wifiScanInterval ? 0 : wifiScanInterval - sinceScan;
+    if (untilScan < wait) wait = untilScan;
+  }
+
+  uint32_t untilLinkSample = millisUntilLinkSample(now);
+  if (untilLinkSample < wait) wait = untilLinkSample;
+
+  // Nach erfolgreichem Update zeitnah neu starten
+  if (otaSession.restartAt != 0 && wait > 100) wait = 100;
+
+  // Capture: Puffer schreiben, nächster Export-Chunk oder Wiedergabe-Zeitpunkt
+  uint32_t untilCapture = captureMillisUntilNextTask(now);
+  if (untilCapture < wait) wait = untilCapture;
+
+  return wait;
 }
 
 // ----------------------------------------
@@ -665,8 +1363,44 @@ void loop() {
     performWifiScan();
   }
 
-  // Kleine Pause (1 Millisekunde)
-  // Dies gibt dem ESP32-Scheduler Zeit, andere interne Aufgaben zu erledigen (z.B. WiFi-Stack).
-  // Es ist wichtig, die loop() nicht zu blockieren, um die Stabilität zu gewährleisten.
-  delay(1);
+  // Link-Qualität abtasten und ggf. eine neue RTT-Probe senden
+  if (millisUntilLinkSample(currentMillis) == 0) {
+    char probePayload[LINK_PROBE_PAYLOAD_LEN];
+    // Im Light-Sleep-Modus keine RTT-Probe (würde das Gerät in jedem Intervall aufwecken und senden)
+    bool allowProbe = client.connected() && powerStats.mode != POWER_MODE_LIGHT_SLEEP;
+    if (sampleLink(allowProbe, probePayload, sizeof(probePayload))) {
+      mqttPublish(topic_link_probe, probePayload);
+    }
+  }
+
+  // Firmware-Update: Fortschritt sichern, Abschluss prüfen, ggf. Neustart
+  if (otaPoll()) {
+    publishOtaStatus(true);
+  }
+
+  // PWM-Rampe beendet (Fade-Interrupt): Endzustand melden
+  if (handlePwmFadeEvents() && client.connected()) {
+    reportGpioStates();
+  }
+
+  // Capture: aufgezeichnete Nachrichten ins Flash schreiben, Export und Wiedergabe fortsetzen
+  captureFlushIfDue(millis());
+  if (trafficCapture.exporting && client.connected()) {
+    publishCaptureChunk();
+  }
+  if (captureReplayPoll()) {
+    Serial.println("Capture-Wiedergabe abgeschlossen");
+    publishCaptureStatus(true);
+  }
+
+  // Liegen bereits empfangene Daten im Puffer des WiFiClient, sofort weiterarbeiten
+  // (client.loop() verarbeitet pro Aufruf nur ein MQTT-Paket).
+  if (espClient.available() > 0) {
+    return;
+  }
+
+  // Bis zum nächsten Ereignis schlafen, statt mit delay(1) ständig zu pollen.
+  // Aufgeweckt wird durch Daten auf dem MQTT-Socket, den Scan-Abschluss (notifyLoop)
+  // oder den nächsten fälligen Timer.
+  waitForEvents(mqttSocketFd(), millisUntilNextTask());
 }
\ No newline at end of file
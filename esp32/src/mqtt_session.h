@@ -0,0 +1,110 @@
+#ifndef MQTT_SESSION_H
+#define MQTT_SESSION_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "latency_probe.h"   // CORRELATION_ID_MAX_LEN
+#include "sample_window.h"
+
+// ----------------------------------------
+// Persistente MQTT-Session und Reconnect-Messung
+// Das Gerät verbindet sich mit cleanSession=false und abonniert Befehle mit
+// QoS 1. Der Broker hält die Subscriptions und reiht Befehle ein, während das
+// Gerät kurz offline ist, und stellt sie nach dem Reconnect zu.
+// PubSubClient gibt weder das Session-Present-Flag noch das DUP-Flag an den
+// Callback weiter. Zugestellte Befehle werden deshalb so erkannt:
+// - backlog: Befehle, die kurz nach dem CONNACK eintreffen (vom Broker eingereiht)
+// - duplicate: Befehle mit bereits gesehener Korrelations-ID (QoS-1-Wiederholung)
+// ----------------------------------------
+
+#define MQTT_SESSION_WINDOW_SIZE 16
+#define MQTT_BACKLOG_WINDOW_MS 1000   // Befehle in diesem Zeitfenster nach dem Connect gelten als eingereiht
+#define MQTT_RECENT_CID_COUNT 8       // Anzahl der gemerkten Korrelations-IDs
+
+struct MqttSessionStats {
+  uint32_t connects = 0;             // Erfolgreiche Verbindungen seit Boot
+  uint32_t failedAttempts = 0;       // Fehlgeschlagene connect()-Versuche
+  uint32_t reconnectStartedAt = 0;   // millis() beim Beginn des (Re-)Connects
+  uint32_t connectedAt = 0;          // millis() nach dem CONNACK
+  uint32_t backlogCommands = 0;      // Befehle kurz nach dem Connect (aus der Session-Queue)
+  uint32_t duplicateCommands = 0;    // Befehle mit bereits verarbeiteter Korrelations-ID
+  SampleWindow<uint32_t, MQTT_SESSION_WINDOW_SIZE> connectMs;  // Dauer von client.connect() (TCP + CONNACK)
+  SampleWindow<uint32_t, MQTT_SESSION_WINDOW_SIZE> readyMs;    // Beginn Reconnect -> Subscriptions gesendet
+  char recentCids[MQTT_RECENT_CID_COUNT][CORRELATION_ID_MAX_LEN + 1] = {};
+  int nextCid = 0;
+};
+
+MqttSessionStats mqttSession;
+
+// Zu Beginn von reconnect_mqtt() (einmal pro Verbindungsverlust)
+void markMqttReconnectStart() {
+  mqttSession.reconnectStartedAt = millis();
+}
+
+// Nach einem connect()-Versuch mit dessen Dauer
+void markMqttConnectAttempt(bool success, uint32_t durationMs) {
+  if (!success) {
+    mqttSession.failedAttempts++;
+    return;
+  }
+  mqttSession.connects++;
+  mqttSession.connectedAt = millis();
+  mqttSession.connectMs.add(durationMs);
+}
+
+// Nach dem Abonnieren: Gerät ist bereit, Befehle zu verarbeiten
+void markMqttReady() {
+  uint32_t readyAfter = millis() - mqttSession.reconnectStartedAt;
+  mqttSession.readyMs.add(readyAfter);
+  Serial.print("MQTT bereit nach ");
+  Serial.print(readyAfter);
+  Serial.println(" ms");
+}
+
+// ----------------------------------------
+// Funktion: noteCommandDelivery
+// Wird für jeden Befehl aufgerufen. Gibt true zurück, wenn die
+// Korrelations-ID bereits verarbeitet wurde (Wiederholung -> nicht erneut schalten).
+// ----------------------------------------
+bool noteCommandDelivery(const char* cid) {
+  if (millis() - mqttSession.connectedAt < MQTT_BACKLOG_WINDOW_MS) {
+    mqttSession.backlogCommands++;
+  }
+
+  if (cid == nullptr || cid[0] == '\0') return false;
+
+  for (int i = 0; i < MQTT_RECENT_CID_COUNT; i++) {
+    if (strcmp(mqttSession.recentCids[i], cid) == 0) {
+      mqttSession.duplicateCommands++;
+      Serial.print("Befehl bereits verarbeitet (Wiederholung), cid: ");
+      Serial.println(cid);
+      return true;
+    }
+  }
+
+  strlcpy(mqttSession.recentCids[mqttSession.nextCid], cid, sizeof(mqttSession.recentCids[0]));
+  mqttSession.nextCid = (mqttSession.nextCid + 1) % MQTT_RECENT_CID_COUNT;
+  return false;
+}
+
+// Gemerkte Korrelations-IDs verwerfen (z.B. vor der Wiedergabe einer Aufzeichnung,
+// deren Befehle sonst als Wiederholung gelten würden)
+void forgetRecentCommands() {
+  memset(mqttSession.recentCids, 0, sizeof(mqttSession.recentCids));
+  mqttSession.nextCid = 0;
+}
+
+// ----------------------------------------
+// Funktion: mqttSessionStatsToJson
+// Schreibt die Reconnect-Kennzahlen in ein JSON-Objekt (für den Heartbeat)
+// ----------------------------------------
+void mqttSessionStatsToJson(JsonObject obj) {
+  obj["connects"] = mqttSession.connects;
+  obj["failedAttempts"] = mqttSession.failedAttempts;
+  obj["backlogCommands"] = mqttSession.backlogCommands;
+  obj["duplicateCommands"] = mqttSession.duplicateCommands;
+  mqttSession.connectMs.summaryToJson(obj["connectMs"].to<JsonObject>());
+  mqttSession.readyMs.summaryToJson(obj["readyMs"].to<JsonObject>());
+}
+
+#endif // MQTT_SESSION_H
@@ -0,0 +1,589 @@
+#ifndef OTA_UPDATE_H
+#define OTA_UPDATE_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <LittleFS.h>
+#include <esp_ota_ops.h>
+#include <esp_partition.h>
+#include <esp_rom_crc.h>
+#include <mbedtls/sha256.h>
+#include <mbedtls/md.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include "json_arena.h"
+#include "power_manager.h"   // notifyLoop()
+
+// ----------------------------------------
+// Firmware-Update (OTA) über MQTT
+// Das Image wird in Chunks über esp32/<id>/ota/chunk empfangen und direkt
+// in die inaktive OTA-Partition geschrieben – es liegt nie komplett im RAM.
+// Zwei Chunk-Puffer (Double Buffering): Während ein Writer-Task einen Puffer
+// in den Flash schreibt (inkl. Sektor-Löschen), wird der nächste Chunk bereits
+// vom MQTT-Callback in den zweiten Puffer übernommen.
+//
+// Chunk-Format (binär): [uint32 offset][uint32 crc32][Daten], Little Endian.
+// Der Fortschritt wird auf LittleFS gesichert, so dass ein Update nach einem
+// Verbindungsabbruch oder Neustart an der letzten Sektorgrenze fortgesetzt wird.
+// Quittungen auf ota/status kommen nur alle OTA_STATUS_EVERY Chunks, am Ende
+// des Images und beim ersten verworfenen Chunk (der Absender sendet dann ab
+// dem gemeldeten "offset" erneut).
+//
+// Autorisierung: ota/begin muss "hmac" = HMAC-SHA256(OTA_SHARED_SECRET,
+// sha256-Hex in Kleinbuchstaben) enthalten. Ohne Secret (secrets.h) ist OTA
+// abgeschaltet. Da das Image am Ende gegen den SHA-256 geprüft wird, kann nur
+// ein vom Secret-Inhaber freigegebenes Image geflasht werden.
+//
+// Boot-Prüfung: Ein neues Image muss sich innerhalb von OTA_VERIFY_TIMEOUT_MS
+// mit MQTT verbinden, sonst wird auf das vorherige Image zurückgeschaltet
+// (geprüft auch während des Wartens auf WLAN). Unterstützt der Bootloader
+// Rollback (CONFIG_APP_ROLLBACK_ENABLE), übernimmt die Firmware selbst die
+// Bestätigung: verifyRollbackLater() verhindert, dass der Arduino-Core das
+// Image schon beim Start als gültig markiert.
+// ----------------------------------------
+
+#define OTA_STATE_FILE "/ota.json"
+#define OTA_CHUNK_HEADER_SIZE 8
+#define OTA_CHUNK_MAX 1536                // Nutzdaten pro Chunk; + Header + Topic bleibt unter setBufferSize(2048)
+#define OTA_BUFFER_COUNT 2                // Double Buffering
+#define OTA_BUFFER_WAIT_MS 2000           // Max. Wartezeit auf den Writer-Task beim Start/Abbruch
+#define OTA_CHUNK_WAIT_MS 200             // Max. Wartezeit des Callbacks auf einen freien Puffer (Sektor-Erase ~50-100 ms)
+#define OTA_STATUS_EVERY 8                // Quittung auf ota/status alle N übernommenen Chunks
+#define OTA_SECTOR_SIZE 4096
+#define OTA_PERSIST_INTERVAL 65536        // Fortschritt alle 64 KB auf LittleFS sichern
+#define OTA_VERIFY_TIMEOUT_MS 120000      // Neues Image muss sich innerhalb von 2 Minuten mit MQTT verbinden
+#define OTA_MAX_BOOT_ATTEMPTS 3           // Danach Rückfall auf das vorherige Image
+
+#ifndef OTA_SHARED_SECRET
+#define OTA_SHARED_SECRET ""              // Leer = OTA abgeschaltet (secrets.h)
+#endif
+
+enum OtaState {
+  OTA_IDLE,
+  OTA_RECEIVING,
+  OTA_VERIFYING,
+  OTA_DONE,
+  OTA_ERROR
+};
+
+struct OtaBuffer {
+  uint32_t offset;
+  uint32_t length;
+  uint8_t data[OTA_CHUNK_MAX];
+};
+
+struct OtaSession {
+  volatile OtaState state = OTA_IDLE;
+  const esp_partition_t* partition = nullptr;
+  uint32_t size = 0;                      // Gesamtgröße des Images
+  char sha256[65] = "";                   // Erwarteter SHA-256 (hex)
+  uint32_t nextOffset = 0;                // Nächster erwarteter Chunk-Offset
+  volatile uint32_t writtenOffset = 0;    // Bis hier ist das Image im Flash
+  uint32_t erasedUntil = 0;               // Bis hier ist die Partition gelöscht (nur Writer-Task)
+  uint32_t persistedOffset = 0;           // Zuletzt auf LittleFS gesicherter Fortschritt
+  volatile esp_err_t writeError = ESP_OK; // Fehler des Writer-Tasks
+  const char* error = "";                 // Letzte Fehlermeldung für ota/status
+  uint32_t startedAt = 0;                 // millis() beim Start (für die Übertragungsdauer)
+  uint32_t finishedAt = 0;
+  uint32_t restartAt = 0;                 // Neustart-Zeitpunkt nach erfolgreichem Update
+  uint32_t chunksSinceStatus = 0;         // Übernommene Chunks seit der letzten Quittung
+  bool rejectReported = false;            // Verworfener Chunk bereits gemeldet (bis zum nächsten Treffer)
+};
+
+// Zustand für die Prüfung des neuen Images nach dem Neustart
+struct OtaBootCheck {
+  bool pendingVerify = false;             // Neues Image noch nicht bestätigt
+  bool nativeRollback = false;            // Bootloader unterstützt Rollback (ESP_OTA_IMG_PENDING_VERIFY)
+  uint32_t deadline = 0;                  // millis(), bis zu dem MQTT verbunden sein muss
+  char previous[17] = "";                 // Label der vorherigen App-Partition
+  int bootCount = 0;
+};
+
+OtaSession otaSession;
+OtaBootCheck otaBootCheck;
+OtaBuffer otaBuffers[OTA_BUFFER_COUNT];
+QueueHandle_t otaFreeQueue = nullptr;     // Indizes freier Puffer
+QueueHandle_t otaWriteQueue = nullptr;    // Indizes gefüllter Puffer (für den Writer-Task)
+
+const char* otaStateName(OtaState state) {
+  switch (state) {
+    case OTA_RECEIVING: return "receiving";
+    case OTA_VERIFYING: return "verifying";
+    case OTA_DONE: return "done";
+    case OTA_ERROR: return "error";
+    default: return "idle";
+  }
+}
+
+// ----------------------------------------
+// Funktion: saveOtaState / loadOtaState
+// Sichert bzw. lädt Fortschritt und Boot-Prüfung in OTA_STATE_FILE
+// ----------------------------------------
+bool saveOtaState() {
+  JsonDocument doc(&jsonArena);
+  doc["size"] = otaSession.size;
+  doc["sha256"] = otaSession.sha256;
+  doc["offset"] = otaSession.persistedOffset;
+  doc["partition"] = otaSession.partition ? otaSession.partition->label : "";
+  doc["pendingVerify"] = otaBootCheck.pendingVerify;
+  doc["previous"] = otaBootCheck.previous;
+  doc["bootCount"] = otaBootCheck.bootCount;
+
+  File file = LittleFS.open(OTA_STATE_FILE, "w");
+  if (!file) {
+    Serial.println("Fehler beim Öffnen der OTA-Statusdatei zum Schreiben!");
+    return false;
+  }
+  size_t bytesWritten = serializeJson(doc, file);
+  file.close();
+  return bytesWritten > 0;
+}
+
+bool loadOtaState(JsonDocument& doc) {
+  if (!LittleFS.exists(OTA_STATE_FILE)) return false;
+  File file = LittleFS.open(OTA_STATE_FILE, "r");
+  if (!file) return false;
+  DeserializationError error = deserializeJson(doc, file);
+  file.close();
+  return !error;
+}
+
+// ----------------------------------------
+// Funktion: otaWriterTask
+// Schreibt gefüllte Puffer in die OTA-Partition und gibt sie wieder frei.
+// Löscht Sektoren erst, wenn sie gebraucht werden (kein Voll-Erase vorab).
+// ----------------------------------------
+void otaWriterTask(void* parameter) {
+  uint8_t idx;
+  for (;;) {
+    if (xQueueReceive(otaWriteQueue, &idx, portMAX_DELAY) != pdTRUE) continue;
+    OtaBuffer& buffer = otaBuffers[idx];
+
+    if (otaSession.state == OTA_RECEIVING && otaSession.writeError == ESP_OK) {
+      esp_err_t err = ESP_OK;
+      uint32_t end = buffer.offset + buffer.length;
+
+      if (end > otaSession.erasedUntil) {
+        uint32_t eraseEnd = (end + OTA_SECTOR_SIZE - 1) & ~(uint32_t)(OTA_SECTOR_SIZE - 1);
+        err = esp_partition_erase_range(otaSession.partition, otaSession.erasedUntil, eraseEnd - otaSession.erasedUntil);
+        if (err == ESP_OK) otaSession.erasedUntil = eraseEnd;
+      }
+      if (err == ESP_OK) {
+        err = esp_partition_write(otaSession.partition, buffer.offset, buffer.data, buffer.length);
+      }
+
+      if (err == ESP_OK) otaSession.writtenOffset = end;
+      else otaSession.writeError = err;
+    }
+
+    xQueueSend(otaFreeQueue, &idx, 0);
+    notifyLoop(); // Hauptschleife: Fortschritt sichern / Abschluss prüfen
+  }
+}
+
+// Wartet, bis der Writer-Task alle Puffer zurückgegeben hat
+bool otaWaitForWriter(uint32_t timeoutMs) {
+  uint32_t start = millis();
+  while (uxQueueMessagesWaiting(otaFreeQueue) < OTA_BUFFER_COUNT) {
+    if (millis() - start > timeoutMs) return false;
+    delay(5);
+  }
+  return true;
+}
+
+void otaFail(const char* reason) {
+  otaSession.state = OTA_ERROR;
+  otaSession.error = reason;
+  Serial.print("OTA-Fehler: ");
+  Serial.println(reason);
+}
+
+// ----------------------------------------
+// Funktion: otaAuthorized
+// Prüft "hmac" aus ota/begin: HMAC-SHA256(OTA_SHARED_SECRET, sha256-Hex)
+// als Hex-String. Vergleich ohne frühen Abbruch (keine Timing-Auskunft).
+// ----------------------------------------
+bool otaAuthorized(const char* sha256, const char* hmac) {
+  const char* secret = OTA_SHARED_SECRET;
+  if (secret[0] == '\0' || hmac == nullptr || strlen(hmac) != 64) return false;
+
+  char digestHex[65];
+  for (int i = 0; i < 64; i++) digestHex[i] = tolower((unsigned char)sha256[i]);
+  digestHex[64] = '\0';
+
+  uint8_t mac[32];
+  if (mbedtls_md_hmac(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256),
+                      (const unsigned char*)secret, strlen(secret),
+                      (const unsigned char*)digestHex, 64, mac) != 0) {
+    return false;
+  }
+
+  char expected[65];
+  for (int i = 0; i < 32; i++) sprintf(expected + i * 2, "%02x", mac[i]);
+  uint8_t diff = 0;
+  for (int i = 0; i < 64; i++) diff |= expected[i] ^ (char)tolower((unsigned char)hmac[i]);
+  return diff == 0;
+}
+
+// ----------------------------------------
+// Funktion: otaBegin
+// Startet ein Update oder setzt ein unterbrochenes Update mit gleichem
+// Image (size + sha256) fort. Gibt false zurück, wenn das Update abgelehnt wird.
+// ----------------------------------------
+bool otaBegin(uint32_t size, const char* sha256, const char* hmac) {
+  if (sha256 == nullptr || strlen(sha256) != 64) {
+    otaFail("invalid sha256");
+    return false;
+  }
+  if (!otaAuthorized(sha256, hmac)) {
+    Serial.println("OTA abgelehnt: HMAC fehlt oder ist ungültig (OTA_SHARED_SECRET).");
+    // Eine laufende Übertragung nicht durch einen fremden Absender abbrechen lassen
+    if (otaSession.state != OTA_RECEIVING) otaFail("unauthorized");
+    return false;
+  }
+
+  bool sameImage = otaSession.size == size && strcasecmp(otaSession.sha256, sha256) == 0;
+
+  // Fortsetzen nach Verbindungsabbruch: Sitzung läuft noch im RAM
+  if (otaSession.state == OTA_RECEIVING && sameImage) {
+    otaSession.chunksSinceStatus = 0;
+    otaSession.rejectReported = false;
+    Serial.print("OTA wird fortgesetzt bei Offset ");
+    Serial.println(otaSession.nextOffset);
+    return true;
+  }
+
+  // Laufende Schreibvorgänge einer alten Sitzung abwarten
+  otaSession.state = OTA_IDLE;
+  if (!otaWaitForWriter(OTA_BUFFER_WAIT_MS)) {
+    otaFail("writer busy");
+    return false;
+  }
+
+  const esp_partition_t* partition = esp_ota_get_next_update_partition(nullptr);
+  if (partition == nullptr) {
+    otaFail("no ota partition");
+    return false;
+  }
+  if (size == 0 || size > partition->size) {
+    otaFail("image too large");
+    return false;
+  }
+
+  // Fortsetzen nach Neustart: Fortschritt aus LittleFS übernehmen (ab Sektorgrenze)
+  uint32_t resumeOffset = 0;
+  JsonDocument saved(&jsonArena);
+  if (loadOtaState(saved) &&
+      (saved["size"] | 0u) == size &&
+      strcasecmp(saved["sha256"] | "", sha256) == 0 &&
+      strcmp(saved["partition"] | "", partition->label) == 0) {
+    resumeOffset = (saved["offset"] | 0u) & ~(uint32_t)(OTA_SECTOR_SIZE - 1);
+  }
+
+  otaSession.partition = partition;
+  otaSession.size = size;
+  strlcpy(otaSession.sha256, sha256, sizeof(otaSession.sha256));
+  otaSession.nextOffset = resumeOffset;
+  otaSession.writtenOffset = resumeOffset;
+  otaSession.erasedUntil = resumeOffset;
+  otaSession.persistedOffset = resumeOffset;
+  otaSession.writeError = ESP_OK;
+  otaSession.error = "";
+  otaSession.startedAt = millis();
+  otaSession.finishedAt = 0;
+  otaSession.chunksSinceStatus = 0;
+  otaSession.rejectReported = false;
+  otaSession.state = OTA_RECEIVING;
+  saveOtaState();
+
+  Serial.print("OTA gestartet: ");
+  Serial.print(size);
+  Serial.print(" Bytes nach Partition ");
+  Serial.print(partition->label);
+  Serial.print(", ab Offset ");
+  Serial.println(resumeOffset);
+  return true;
+}
+
+// ----------------------------------------
+// Funktion: otaAcceptChunk
+// Prüft einen Chunk (Offset + CRC32) und übergibt ihn an den Writer-Task.
+// Chunks mit unerwartetem Offset (Duplikate, Lücken) werden verworfen;
+// der Absender richtet sich nach dem "offset" in ota/status.
+// Gibt true zurück, wenn der Chunk übernommen wurde.
+// ----------------------------------------
+bool otaAcceptChunk(const byte* payload, unsigned int length) {
+  if (otaSession.state != OTA_RECEIVING) return false;
+  if (otaSession.writeError != ESP_OK) {
+    otaFail("flash write failed");
+    return false;
+  }
+  if (length <= OTA_CHUNK_HEADER_SIZE || length - OTA_CHUNK_HEADER_SIZE > OTA_CHUNK_MAX) {
+    return false;
+  }
+
+  uint32_t offset, crc;
+  memcpy(&offset, payload, 4);
+  memcpy(&crc, payload + 4, 4);
+  const byte* data = payload + OTA_CHUNK_HEADER_SIZE;
+  uint32_t dataLength = length - OTA_CHUNK_HEADER_SIZE;
+
+  if (offset != otaSession.nextOffset || offset + dataLength > otaSession.size) return false;
+  if (esp_rom_crc32_le(0, data, dataLength) != crc) {
+    Serial.print("OTA-Chunk mit falscher CRC bei Offset ");
+    Serial.println(offset);
+    return false;
+  }
+
+  // Freien Puffer holen; sind beide belegt, wartet der Callback kurz auf den Writer-Task.
+  // Das bremst den Empfang über TCP aus (Flusskontrolle).
+  uint8_t idx;
+  if (xQueueReceive(otaFreeQueue, &idx, pdMS_TO_TICKS(OTA_CHUNK_WAIT_MS)) != pdTRUE) {
+    Serial.println("OTA: Kein freier Puffer (Flash zu langsam), Chunk verworfen.");
+    return false;
+  }
+
+  otaBuffers[idx].offset = offset;
+  otaBuffers[idx].length = dataLength;
+  memcpy(otaBuffers[idx].data, data, dataLength);
+  xQueueSend(otaWriteQueue, &idx, 0);
+
+  otaSession.nextOffset = offset + dataLength;
+  return true;
+}
+
+// ----------------------------------------
+// Funktion: otaChunkStatusDue
+// Entscheidet nach einem Chunk, ob ota/status gesendet wird: alle
+// OTA_STATUS_EVERY Chunks, am Ende des Images und beim ersten verworfenen
+// Chunk. Die Chunks danach (falscher Offset) werden still verworfen.
+// ----------------------------------------
+bool otaChunkStatusDue(bool accepted) {
+  if (!accepted) {
+    if (otaSession.rejectReported) return false;
+    otaSession.rejectReported = true;
+    otaSession.chunksSinceStatus = 0;
+    return true;
+  }
+
+  otaSession.rejectReported = false;
+  if (++otaSession.chunksSinceStatus >= OTA_STATUS_EVERY || otaSession.nextOffset >= otaSession.size) {
+    otaSession.chunksSinceStatus = 0;
+    return true;
+  }
+  return false;
+}
+
+void otaAbort() {
+  otaSession.state = OTA_IDLE;
+  otaSession.error = "aborted";
+  otaWaitForWriter(OTA_BUFFER_WAIT_MS);
+  otaSession.persistedOffset = 0;
+  otaSession.size = 0;
+  otaSession.sha256[0] = '\0';
+  saveOtaState();
+  Serial.println("OTA abgebrochen.");
+}
+
+// ----------------------------------------
+// Funktion: otaVerifyImage
+// Liest das geschriebene Image aus dem Flash zurück und vergleicht den SHA-256
+// mit dem angekündigten Wert. Prüft damit Übertragung und Flash-Inhalt.
+// ----------------------------------------
+bool otaVerifyImage() {
+  mbedtls_sha256_context ctx;
+  mbedtls_sha256_init(&ctx);
+  mbedtls_sha256_starts(&ctx, 0);
+
+  // Puffer des (jetzt untätigen) Writer-Tasks als Lesepuffer wiederverwenden
+  uint8_t* block = otaBuffers[0].data;
+  for (uint32_t offset = 0; offset < otaSession.size; offset += OTA_CHUNK_MAX) {
+    uint32_t len = otaSession.size - offset < OTA_CHUNK_MAX ? otaSession.size - offset : OTA_CHUNK_MAX;
+    if (esp_partition_read(otaSession.partition, offset, block, len) != ESP_OK) {
+      mbedtls_sha256_free(&ctx);
+      return false;
+    }
+    mbedtls_sha256_update(&ctx, block, len);
+  }
+
+  uint8_t digest[32];
+  mbedtls_sha256_finish(&ctx, digest);
+  mbedtls_sha256_free(&ctx);
+
+  char hex[65];
+  for (int i = 0; i < 32; i++) sprintf(hex + i * 2, "%02x", digest[i]);
+  return strcasecmp(hex, otaSession.sha256) == 0;
+}
+
+// ----------------------------------------
+// Funktion: otaPoll
+// Wird aus loop() aufgerufen: sichert den Fortschritt und schließt das Update
+// ab, sobald alle Daten im Flash sind. Gibt true zurück, wenn sich der Status
+// geändert hat und ota/status veröffentlicht werden sollte.
+// ----------------------------------------
+bool otaPoll() {
+  if (otaSession.state == OTA_DONE && otaSession.restartAt != 0 && millis() >= otaSession.restartAt) {
+    Serial.println("Neustart mit neuer Firmware...");
+    delay(100);
+    esp_restart();
+  }
+
+  if (otaSession.state != OTA_RECEIVING) return false;
+
+  if (otaSession.writeError != ESP_OK) {
+    otaFail("flash write failed");
+    return true;
+  }
+
+  if (otaSession.writtenOffset - otaSession.persistedOffset >= OTA_PERSIST_INTERVAL) {
+    otaSession.persistedOffset = otaSession.writtenOffset;
+    saveOtaState();
+  }
+
+  if (otaSession.writtenOffset < otaSession.size) return false;
+
+  // Alle Daten geschrieben -> Image prüfen und als Boot-Partition setzen
+  otaSession.state = OTA_VERIFYING;
+  otaSession.finishedAt = millis();
+  Serial.println("OTA: Alle Daten empfangen, prüfe Image...");
+
+  if (!otaVerifyImage()) {
+    otaSession.persistedOffset = 0; // Kaputtes Image nicht fortsetzen
+    saveOtaState();
+    otaFail("sha256 mismatch");
+    return true;
+  }
+
+  if (esp_ota_set_boot_partition(otaSession.partition) != ESP_OK) {
+    otaFail("invalid image");
+    return true;
+  }
+
+  // Für die Boot-Prüfung merken, von welcher Partition wir kommen
+  otaBootCheck.pendingVerify = true;
+  otaBootCheck.bootCount = 0;
+  strlcpy(otaBootCheck.previous, esp_ota_get_running_partition()->label, sizeof(otaBootCheck.previous));
+  otaSession.persistedOffset = 0;
+  saveOtaState();
+
+  otaSession.state = OTA_DONE;
+  otaSession.restartAt = millis() + 1000; // Zeit, um ota/status noch zu senden
+  Serial.println("OTA erfolgreich, Neustart in 1 Sekunde.");
+  return true;
+}
+
+// ----------------------------------------
+// Funktion: otaRollback
+// Kehrt zum vorherigen Image zurück und startet neu
+// ----------------------------------------
+void otaRollback(const char* reason) {
+  Serial.print("OTA-Rollback: ");
+  Serial.println(reason);
+
+  if (otaBootCheck.nativeRollback) {
+    esp_ota_mark_app_invalid_rollback_and_reboot();
+  }
+
+  const esp_partition_t* previous = esp_partition_find_first(
+    ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_ANY, otaBootCheck.previous);
+  otaBootCheck.pendingVerify = false;
+  saveOtaState();
+  if (previous != nullptr) esp_ota_set_boot_partition(previous);
+  delay(100);
+  esp_restart();
+}
+
+// Vom Arduino-Core (initArduino) abgefragt: true = die Anwendung bestätigt
+// ein Image im Zustand ESP_OTA_IMG_PENDING_VERIFY selbst (otaConfirmBoot)
+extern "C" bool verifyRollbackLater() {
+  return true;
+}
+
+// ----------------------------------------
+// Funktion: initOta
+// Legt Puffer-Queues und Writer-Task an und prüft, ob ein frisch
+// installiertes Image noch bestätigt werden muss.
+// Muss nach initLittleFS() aufgerufen werden.
+// ----------------------------------------
+void initOta() {
+  otaFreeQueue = xQueueCreate(OTA_BUFFER_COUNT, sizeof(uint8_t));
+  otaWriteQueue = xQueueCreate(OTA_BUFFER_COUNT, sizeof(uint8_t));
+  for (uint8_t i = 0; i < OTA_BUFFER_COUNT; i++) xQueueSend(otaFreeQueue, &i, 0);
+
+  // Writer auf Core 0, die Arduino-loop() läuft auf Core 1
+  xTaskCreatePinnedToCore(otaWriterTask, "ota_writer", 4096, nullptr, 1, nullptr, 0);
+
+  const esp_partition_t* running = esp_ota_get_running_partition();
+  esp_ota_img_states_t imgState;
+  otaBootCheck.nativeRollback = esp_ota_get_state_partition(running, &imgState) == ESP_OK &&
+                                imgState == ESP_OTA_IMG_PENDING_VERIFY;
+
+  JsonDocument saved(&jsonArena);
+  if (loadOtaState(saved)) {
+    otaBootCheck.pendingVerify = saved["pendingVerify"] | false;
+    otaBootCheck.bootCount = saved["bootCount"] | 0;
+    strlcpy(otaBootCheck.previous, saved["previous"] | "", sizeof(otaBootCheck.previous));
+    otaSession.size = saved["size"] | 0u;
+    strlcpy(otaSession.sha256, saved["sha256"] | "", sizeof(otaSession.sha256));
+    otaSession.persistedOffset = saved["offset"] | 0u;
+  }
+
+  // Wir laufen noch auf der alten Partition (Bootloader ist zurückgefallen)
+  if (otaBootCheck.pendingVerify && strcmp(running->label, otaBootCheck.previous) == 0) {
+    otaBootCheck.pendingVerify = false;
+    saveOtaState();
+  }
+
+  if (otaBootCheck.pendingVerify || otaBootCheck.nativeRollback) {
+    otaBootCheck.pendingVerify = true;
+    otaBootCheck.bootCount++;
+    saveOtaState();
+    Serial.print("Neues Image wartet auf Bestätigung (Boot-Versuch ");
+    Serial.print(otaBootCheck.bootCount);
+    Serial.println(")");
+
+    if (otaBootCheck.bootCount > OTA_MAX_BOOT_ATTEMPTS) {
+      otaRollback("too many boot attempts");
+    }
+    otaBootCheck.deadline = millis() + OTA_VERIFY_TIMEOUT_MS;
+  }
+}
+
+// ----------------------------------------
+// Funktion: otaConfirmBoot
+// Nach der ersten erfolgreichen MQTT-Verbindung: neues Image ist gültig
+// ----------------------------------------
+void otaConfirmBoot() {
+  if (!otaBootCheck.pendingVerify) return;
+  if (otaBootCheck.nativeRollback) esp_ota_mark_app_valid_cancel_rollback();
+  otaBootCheck.pendingVerify = false;
+  otaBootCheck.nativeRollback = false;
+  otaBootCheck.bootCount = 0;
+  saveOtaState();
+  Serial.println("Neues Image bestätigt.");
+}
+
+// Prüft, ob das neue Image zu lange keine MQTT-Verbindung bekommen hat.
+// Wird beim Warten auf WLAN und bei fehlgeschlagenen MQTT-Verbindungen aufgerufen.
+void otaCheckBootDeadline() {
+  if (otaBootCheck.pendingVerify && (int32_t)(millis() - otaBootCheck.deadline) >= 0) {
+    otaRollback("no connection after update");
+  }
+}
+
+// ----------------------------------------
+// Funktion: otaStatusToJson
+// Status für ota/status; "offset" ist der nächste erwartete Chunk-Offset
+// ----------------------------------------
+void otaStatusToJson(JsonObject obj) {
+  obj["state"] = otaStateName(otaSession.state);
+  obj["size"] = otaSession.size;
+  obj["offset"] = otaSession.nextOffset;
+  obj["written"] = otaSession.writtenOffset;
+  obj["chunkMax"] = OTA_CHUNK_MAX;
+  if (otaSession.finishedAt != 0) obj["durationMs"] = otaSession.finishedAt - otaSession.startedAt;
+  if (otaSession.error[0] != '\0') obj["error"] = otaSession.error;
+  obj["running"] = esp_ota_get_running_partition()->label;
+}
+
+#endif // OTA_UPDATE_H
@@ -0,0 +1,216 @@
+#ifndef POWER_MANAGER_H
+#define POWER_MANAGER_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <WiFi.h>
+#include <esp_pm.h>
+#include <esp_vfs_eventfd.h>
+#include <sys/select.h>
+#include "sample_window.h"
+
+// ----------------------------------------
+// Ereignisgesteuerte Hauptschleife und Energiesparmodi
+// Statt loop() ständig durchlaufen zu lassen, blockiert waitForEvents() bis
+// Daten auf dem MQTT-Socket anliegen, ein Ereignis signalisiert wurde
+// (z.B. WiFi-Scan fertig) oder der nächste Timer fällig ist.
+// Während der Wartezeit kann die CPU heruntergetaktet werden bzw. in den
+// automatischen Light Sleep gehen.
+// ----------------------------------------
+
+// Energiesparmodi (werden in den Settings als Zahl gespeichert)
+#define POWER_MODE_PERFORMANCE 0  // 240 MHz, WiFi Power Save aus (bisheriges Verhalten)
+#define POWER_MODE_DFS 1          // CPU im Leerlauf auf 80 MHz, WiFi Modem Sleep
+#define POWER_MODE_LIGHT_SLEEP 2  // Automatischer Light Sleep im Leerlauf, WiFi Modem Sleep
+
+#define POWER_CPU_MAX_MHZ 240
+#define POWER_CPU_IDLE_MHZ 80     // Niedrigster Takt, bei dem der APB-Takt (UART, LEDC) unverändert bleibt
+#define POWER_WINDOW_SIZE 32
+#define POWER_MODE_COUNT 3
+
+const char* const powerModeNames[POWER_MODE_COUNT] = {"performance", "dfs", "lightSleep"};
+
+struct PowerStats {
+  int mode = POWER_MODE_PERFORMANCE;
+  bool pmConfigured = false;      // esp_pm_configure() erfolgreich (sonst manuelles Umschalten)
+  uint32_t wakeups = 0;           // Anzahl der Aufwachvorgänge
+  uint64_t idleMicros = 0;        // Summe der Zeit in waitForEvents()
+  uint64_t activeMicros = 0;      // Summe der Zeit außerhalb von waitForEvents()
+  uint32_t lastWakeAt = 0;        // micros() direkt nach der Rückkehr aus select()
+  uint32_t lastSleepAt = 0;       // micros() beim letzten Einschlafen
+  // Aufwachen -> Pin geschaltet (µs), getrennt pro Modus, damit die Modi vergleichbar bleiben.
+  // Enthält Takt-Wiederherstellung und PM-Lock des jeweiligen Modus; die Verzögerung
+  // bis zum Empfang (DTIM, Light-Sleep-Austritt) ist nur Ende-zu-Ende sichtbar (Ping).
+  SampleWindow<uint32_t, POWER_WINDOW_SIZE> wakeToActuate[POWER_MODE_COUNT];
+};
+
+PowerStats powerStats;
+int loopEventFd = -1;                         // eventfd zum Aufwecken der Hauptschleife
+esp_pm_lock_handle_t cpuFreqLock = nullptr;   // Hält den maximalen Takt während der Verarbeitung
+
+// ----------------------------------------
+// Funktion: notifyLoop
+// Weckt die Hauptschleife auf (aus WiFi-Event-Handlern, Tasks oder ISRs)
+// ----------------------------------------
+void notifyLoop() {
+  if (loopEventFd < 0) return;
+  uint64_t one = 1;
+  write(loopEventFd, &one, sizeof(one));
+}
+
+// Takt nur umschalten, wenn er sich ändert (setCpuFrequencyMhz() stellt
+// u.a. APB- und UART-Takt neu ein und ist nicht kostenlos)
+void setCpuFrequencyIfChanged(uint32_t mhz) {
+  if (getCpuFrequencyMhz() != mhz) setCpuFrequencyMhz(mhz);
+}
+
+// WiFi-Event: Scan abgeschlossen -> Hauptschleife aufwecken
+void onWifiScanDone(WiFiEvent_t event, WiFiEventInfo_t info) {
+  notifyLoop();
+}
+
+// ----------------------------------------
+// Funktion: applyPowerMode
+// Aktiviert einen Energiesparmodus. Ist das Power Management im Framework
+// nicht verfügbar, wird der Takt in waitForEvents() manuell umgeschaltet.
+// ----------------------------------------
+void applyPowerMode(int mode) {
+  if (mode < POWER_MODE_PERFORMANCE || mode > POWER_MODE_LIGHT_SLEEP) {
+    mode = POWER_MODE_PERFORMANCE;
+  }
+  powerStats.mode = mode;
+
+  // Modem Sleep ist Voraussetzung für Light Sleep bei aktiver WLAN-Verbindung.
+  // WIFI_PS_MIN_MODEM wacht zu jedem DTIM auf und hält die Befehlslatenz gering.
+  WiFi.setSleep(mode == POWER_MODE_PERFORMANCE ? WIFI_PS_NONE : WIFI_PS_MIN_MODEM);
+
+  esp_pm_config_esp32_t pmConfig;
+  pmConfig.max_freq_mhz = POWER_CPU_MAX_MHZ;
+  pmConfig.min_freq_mhz = mode == POWER_MODE_PERFORMANCE ? POWER_CPU_MAX_MHZ : POWER_CPU_IDLE_MHZ;
+  pmConfig.light_sleep_enable = mode == POWER_MODE_LIGHT_SLEEP;
+
+  esp_err_t err = esp_pm_configure(&pmConfig);
+  powerStats.pmConfigured = err == ESP_OK;
+
+  if (powerStats.pmConfigured && cpuFreqLock == nullptr) {
+    esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "loop", &cpuFreqLock);
+    esp_pm_lock_acquire(cpuFreqLock);
+  }
+
+  if (!powerStats.pmConfigured) {
+    setCpuFrequencyIfChanged(POWER_CPU_MAX_MHZ);
+    if (mode == POWER_MODE_LIGHT_SLEEP) {
+      Serial.println("Light Sleep nicht verfügbar (CONFIG_PM_ENABLE fehlt), verwende Taktabsenkung.");
+    }
+  }
+
+  Serial.print("Energiesparmodus aktiv: ");
+  Serial.print(mode);
+  Serial.println(powerStats.pmConfigured ? " (esp_pm)" : " (manuell)");
+}
+
+// ----------------------------------------
+// Funktion: initPowerManager
+// Legt den eventfd an und registriert die WiFi-Events
+// ----------------------------------------
+void initPowerManager(int mode) {
+  esp_vfs_eventfd_config_t config = ESP_VFS_EVENTD_CONFIG_DEFAULT();
+  if (esp_vfs_eventfd_register(&config) == ESP_OK) {
+    loopEventFd = eventfd(0, EFD_SUPPORT_ISR); // notifyLoop() ist auch aus Interrupts erlaubt
+  }
+  if (loopEventFd < 0) {
+    Serial.println("eventfd nicht verfügbar, Ereignisse werden nur per Timeout erkannt.");
+  }
+
+  WiFi.onEvent(onWifiScanDone, ARDUINO_EVENT_WIFI_SCAN_DONE);
+  applyPowerMode(mode);
+
+  powerStats.lastWakeAt = micros();
+}
+
+// ----------------------------------------
+// Funktion: waitForEvents
+// Blockiert, bis der MQTT-Socket lesbar ist, notifyLoop() aufgerufen wurde
+// oder timeoutMs abgelaufen ist. socketFd < 0 = keine Verbindung.
+// ----------------------------------------
+void waitForEvents(int socketFd, uint32_t timeoutMs) {
+  if (timeoutMs == 0) return;
+
+  powerStats.lastSleepAt = micros();
+  powerStats.activeMicros += powerStats.lastSleepAt - powerStats.lastWakeAt;
+
+  // Takt für die Wartezeit freigeben bzw. manuell absenken
+  if (powerStats.mode != POWER_MODE_PERFORMANCE) {
+    if (powerStats.pmConfigured) esp_pm_lock_release(cpuFreqLock);
+    else setCpuFrequencyIfChanged(POWER_CPU_IDLE_MHZ);
+  }
+
+  fd_set readSet;
+  FD_ZERO(&readSet);
+  int maxFd = -1;
+  if (socketFd >= 0) {
+    FD_SET(socketFd, &readSet);
+    maxFd = socketFd;
+  }
+  if (loopEventFd >= 0) {
+    FD_SET(loopEventFd, &readSet);
+    if (loopEventFd > maxFd) maxFd = loopEventFd;
+  }
+
+  struct timeval tv;
+  tv.tv_sec = timeoutMs / 1000;
+  tv.tv_usec = (timeoutMs % 1000) * 1000;
+
+  if (maxFd >= 0) {
+    select(maxFd + 1, &readSet, nullptr, nullptr, &tv);
+  } else {
+    delay(timeoutMs);
+  }
+
+  // Aufwachzeitpunkt vor dem Hochtakten nehmen: die je Modus unterschiedlich
+  // teure Rückkehr auf vollen Takt gehört zur Aufwach-Latenz
+  powerStats.lastWakeAt = micros();
+  powerStats.idleMicros += powerStats.lastWakeAt - powerStats.lastSleepAt;
+  powerStats.wakeups++;
+
+  // Zurück auf vollen Takt, bevor irgendetwas verarbeitet wird
+  if (powerStats.mode != POWER_MODE_PERFORMANCE) {
+    if (powerStats.pmConfigured) esp_pm_lock_acquire(cpuFreqLock);
+    else setCpuFrequencyIfChanged(POWER_CPU_MAX_MHZ);
+  }
+
+  // Ereigniszähler des eventfd zurücksetzen
+  if (loopEventFd >= 0 && FD_ISSET(loopEventFd, &readSet)) {
+    uint64_t value;
+    read(loopEventFd, &value, sizeof(value));
+  }
+}
+
+// Erfasst die Zeit vom letzten Aufwachen bis zum Schalten eines Pins
+void recordWakeToActuation(uint32_t actuatedAt) {
+  powerStats.wakeToActuate[powerStats.mode].add(actuatedAt - powerStats.lastWakeAt);
+}
+
+// ----------------------------------------
+// Funktion: powerStatsToJson
+// Schreibt Modus, Aktivanteil und Aufwach-Latenz in ein JSON-Objekt.
+// Der Aktivanteil ist ein Indikator für die Stromaufnahme; der tatsächliche
+// Leerlaufstrom pro Modus muss extern (z.B. USB-Strommessgerät) gemessen werden.
+// ----------------------------------------
+void powerStatsToJson(JsonObject obj) {
+  obj["mode"] = powerStats.mode;
+  obj["pm"] = powerStats.pmConfigured;
+  obj["cpuMhz"] = getCpuFrequencyMhz();
+  obj["wakeups"] = powerStats.wakeups;
+  uint64_t total = powerStats.idleMicros + powerStats.activeMicros;
+  obj["activePct"] = total == 0 ? 100.0f : (float)(powerStats.activeMicros * 100.0 / total);
+  // Nur Modi mit Messwerten, z.B. {"performance": {...}, "lightSleep": {...}}
+  // Kompakt, damit der Heartbeat mit allen drei Modi in den MQTT-Puffer passt
+  JsonObject wakeToActuate = obj["wakeToActuate"].to<JsonObject>();
+  for (int m = 0; m < POWER_MODE_COUNT; m++) {
+    if (powerStats.wakeToActuate[m].count == 0) continue;
+    powerStats.wakeToActuate[m].summaryToJson(wakeToActuate[powerModeNames[m]].to<JsonObject>());
+  }
+}
+
+#endif // POWER_MANAGER_H
@@ -0,0 +1,195 @@
+#ifndef PWM_OUTPUT_H
+#define PWM_OUTPUT_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <driver/ledc.h>
+#include <esp_pm.h>
+#include "littlefs_settings.h"
+#include "power_manager.h"   // notifyLoop()
+
+// ----------------------------------------
+// PWM-Ausgänge über den LEDC-Peripheriebaustein
+// Pins mit mode "pwm" in gpioConfigs werden dimmbar. Ein einzelner gpio/set-
+// Befehl setzt Ziel-Tastverhältnis und Fade-Dauer; die Rampe läuft komplett in
+// der Hardware (LEDC Fade Engine), ohne weitere MQTT-Nachrichten oder CPU-Last.
+// Tastverhältnisse werden nach außen in Prozent (0-100) angegeben.
+// ----------------------------------------
+
+#define PWM_SPEED_MODE LEDC_HIGH_SPEED_MODE
+#define PWM_TIMER LEDC_TIMER_0
+#define PWM_RESOLUTION LEDC_TIMER_10_BIT
+#define PWM_MAX_DUTY 1023          // 2^10 - 1
+#define PWM_FREQUENCY_HZ 5000      // Flimmerfrei für Lampen
+#define PWM_MAX_FADE_MS 60000      // Obergrenze für eine Rampe
+#define PWM_MAX_CHANNELS 8         // LEDC-Kanäle im High-Speed-Modus
+
+// Externe Referenzen: werden in main.cpp definiert
+extern int control_pins[];
+extern int gpio_states[];
+
+// Ziel-Tastverhältnis pro Pin (LEDC-Einheiten), Index wie control_pins
+uint32_t pwmTargetDuty[PWM_MAX_CHANNELS] = {0};
+bool pwmChannelActive[PWM_MAX_CHANNELS] = {false};  // Kanal ist aktuell an den Pin gebunden
+bool pwmFadeInstalled = false;
+volatile bool pwmFading[PWM_MAX_CHANNELS] = {false};  // Rampe läuft; wird im Fade-Interrupt pro Kanal gelöscht
+volatile bool pwmFadeFinished = false;  // Wird im Fade-Interrupt gesetzt, in loop() ausgewertet
+esp_pm_lock_handle_t pwmSleepLock = nullptr;  // Verhindert Light Sleep, solange ein PWM-Ausgang aktiv ist
+bool pwmSleepLockHeld = false;
+
+bool isPwmPin(int index) {
+  return strcmp(gpioConfigs[index].mode, "pwm") == 0 && index < PWM_MAX_CHANNELS;
+}
+
+// LEDC-Kanal = Index im control_pins-Array (max. 8 Kanäle im High-Speed-Modus)
+ledc_channel_t pwmChannel(int index) {
+  return (ledc_channel_t)index;
+}
+
+// ----------------------------------------
+// Funktion: onPwmFadeEnd
+// Interrupt-Callback der Fade Engine: Rampe beendet -> State-Report anstoßen
+// ----------------------------------------
+bool IRAM_ATTR onPwmFadeEnd(const ledc_cb_param_t* param, void* arg) {
+  if (param->event == LEDC_FADE_END_EVT) {
+    if (param->channel < PWM_MAX_CHANNELS) pwmFading[param->channel] = false;
+    // Auswertung (State-Report, Sleep-Lock) erfolgt in loop() über handlePwmFadeEvents()
+    pwmFadeFinished = true;
+    notifyLoop();
+  }
+  return false;
+}
+
+// ----------------------------------------
+// Funktion: updatePwmSleepLock
+// Im Light Sleep steht der APB-Takt und damit der LEDC-Ausgang still.
+// Solange ein PWM-Pin leuchtet oder auf irgendeinem Kanal eine Rampe läuft
+// (auch eine Rampe auf 0), wird Light Sleep daher blockiert (DFS bleibt
+// möglich, der APB-Takt bleibt bei 80 MHz).
+// ----------------------------------------
+void updatePwmSleepLock() {
+  bool needed = false;
+  for (int i = 0; i < PWM_MAX_CHANNELS; i++) {
+    if (pwmFading[i]) needed = true;
+    if (pwmChannelActive[i] && pwmTargetDuty[i] > 0) needed = true;
+  }
+
+  if (pwmSleepLock == nullptr) {
+    // Ohne Power Management (CONFIG_PM_ENABLE) gibt es keinen Light Sleep
+    if (esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "pwm", &pwmSleepLock) != ESP_OK) return;
+  }
+
+  if (needed && !pwmSleepLockHeld) esp_pm_lock_acquire(pwmSleepLock);
+  if (!needed && pwmSleepLockHeld) esp_pm_lock_release(pwmSleepLock);
+  pwmSleepLockHeld = needed;
+}
+
+// ----------------------------------------
+// Funktion: configureOutput
+// Richtet einen Pin je nach gpioConfigs[index].mode als digitalen Ausgang
+// oder als LEDC-PWM-Kanal ein. Kann zur Laufzeit erneut aufgerufen werden.
+// ----------------------------------------
+void configureOutput(int index) {
+  int pin = control_pins[index];
+
+  if (!isPwmPin(index)) {
+    if (pwmChannelActive[index]) {
+      ledc_stop(PWM_SPEED_MODE, pwmChannel(index), 0);
+      pwmChannelActive[index] = false;
+      pwmFading[index] = false;
+      updatePwmSleepLock();
+    }
+    pinMode(pin, OUTPUT); // Bindet den Pin wieder an den GPIO-Ausgang statt an LEDC
+    digitalWrite(pin, gpio_states[index]);
+    return;
+  }
+
+  // Timer und Fade-Funktion werden einmalig für alle PWM-Pins eingerichtet
+  if (!pwmFadeInstalled) {
+    ledc_timer_config_t timerConfig = {};
+    timerConfig.speed_mode = PWM_SPEED_MODE;
+    timerConfig.duty_resolution = PWM_RESOLUTION;
+    timerConfig.timer_num = PWM_TIMER;
+    timerConfig.freq_hz = PWM_FREQUENCY_HZ;
+    timerConfig.clk_cfg = LEDC_AUTO_CLK;
+    ledc_timer_config(&timerConfig);
+    ledc_fade_func_install(0);
+    pwmFadeInstalled = true;
+  }
+
+  ledc_channel_config_t channelConfig = {};
+  channelConfig.gpio_num = pin;
+  channelConfig.speed_mode = PWM_SPEED_MODE;
+  channelConfig.channel = pwmChannel(index);
+  channelConfig.timer_sel = PWM_TIMER;
+  channelConfig.duty = gpio_states[index] == HIGH ? PWM_MAX_DUTY : 0;
+  channelConfig.hpoint = 0;
+  ledc_channel_config(&channelConfig);
+  pwmTargetDuty[index] = channelConfig.duty;
+  pwmChannelActive[index] = true;
+
+  ledc_cbs_t callbacks;
+  callbacks.fade_cb = onPwmFadeEnd;
+  ledc_cb_register(PWM_SPEED_MODE, pwmChannel(index), &callbacks, nullptr);
+}
+
+// ----------------------------------------
+// Funktion: setPwmDuty
+// Setzt das Ziel-Tastverhältnis (Prozent). Mit fadeMs > 0 übernimmt die
+// LEDC Fade Engine die Rampe; ein laufender Fade wird dabei ersetzt.
+// Steht der Kanal bereits auf dem Ziel oder lässt sich die Rampe nicht
+// starten, wird das Ziel direkt gesetzt: ohne gestartete Rampe kommt kein
+// Fade-Interrupt, der pwmFading wieder löschen und den Sleep-Lock freigeben würde.
+// ----------------------------------------
+void setPwmDuty(int index, float dutyPercent, uint32_t fadeMs) {
+  if (dutyPercent < 0) dutyPercent = 0;
+  if (dutyPercent > 100) dutyPercent = 100;
+  if (fadeMs > PWM_MAX_FADE_MS) fadeMs = PWM_MAX_FADE_MS;
+
+  uint32_t target = (uint32_t)(dutyPercent * PWM_MAX_DUTY / 100.0f + 0.5f);
+  pwmTargetDuty[index] = target;
+  gpio_states[index] = target > 0 ? HIGH : LOW;
+
+  bool fading = fadeMs > 0 && target != ledc_get_duty(PWM_SPEED_MODE, pwmChannel(index));
+  if (fading) {
+    pwmFading[index] = true;
+    updatePwmSleepLock(); // Vor dem Start der Rampe, damit sie nicht im Light Sleep stehen bleibt
+    fading = ledc_set_fade_with_time(PWM_SPEED_MODE, pwmChannel(index), target, fadeMs) == ESP_OK &&
+             ledc_fade_start(PWM_SPEED_MODE, pwmChannel(index), LEDC_FADE_NO_WAIT) == ESP_OK;
+    if (!fading) Serial.println("Fehler: PWM-Rampe konnte nicht gestartet werden, setze Ziel direkt");
+  }
+
+  if (!fading) {
+    pwmFading[index] = false;
+    ledc_set_duty(PWM_SPEED_MODE, pwmChannel(index), target);
+    ledc_update_duty(PWM_SPEED_MODE, pwmChannel(index));
+    updatePwmSleepLock();
+  }
+}
+
+// ----------------------------------------
+// Funktion: handlePwmFadeEvents
+// Wird aus loop() aufgerufen. Gibt true zurück, wenn seit dem letzten Aufruf
+// eine Rampe beendet wurde (dann sollte der GPIO-Status gemeldet werden).
+// ----------------------------------------
+bool handlePwmFadeEvents() {
+  if (!pwmFadeFinished) return false;
+  pwmFadeFinished = false;
+  updatePwmSleepLock(); // Andere Kanäle können noch in einer Rampe sein
+  return true;
+}
+
+// ----------------------------------------
+// Funktion: pwmStateToJson
+// Hängt Modus, aktuelles und Ziel-Tastverhältnis (Prozent) an ein Pin-Objekt
+// ----------------------------------------
+void pwmStateToJson(int index, JsonObject pinObj) {
+  pinObj["mode"] = gpioConfigs[index].mode;
+  if (!isPwmPin(index)) return;
+
+  uint32_t current = ledc_get_duty(PWM_SPEED_MODE, pwmChannel(index));
+  pinObj["duty"] = roundf(current * 1000.0f / PWM_MAX_DUTY) / 10.0f;
+  pinObj["targetDuty"] = roundf(pwmTargetDuty[index] * 1000.0f / PWM_MAX_DUTY) / 10.0f;
+}
+
+#endif // PWM_OUTPUT_H
@@ -0,0 +1,96 @@
+#ifndef SAMPLE_WINDOW_H
+#define SAMPLE_WINDOW_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// ----------------------------------------
+// SampleWindow
+// Ringpuffer fester Größe für Messwerte (z.B. Latenzen in µs).
+// Hält nur die letzten N Werte, damit Statistiken ohne Heap-Allokation
+// auf dem Gerät berechnet werden können (min/max/mean/Perzentile).
+// ----------------------------------------
+template <typename T, size_t N>
+struct SampleWindow {
+  T samples[N];
+  size_t count = 0;     // Anzahl gültiger Werte im Fenster (max. N)
+  size_t next = 0;      // Schreibposition im Ringpuffer
+  uint32_t total = 0;   // Anzahl aller jemals erfassten Werte
+
+  // Fügt einen Messwert hinzu (überschreibt den ältesten, wenn voll)
+  void add(T value) {
+    samples[next] = value;
+    next = (next + 1) % N;
+    if (count < N) count++;
+    total++;
+  }
+
+  void clear() {
+    count = 0;
+    next = 0;
+    total = 0;
+  }
+
+  T minimum() const {
+    if (count == 0) return 0;
+    T m = samples[0];
+    for (size_t i = 1; i < count; i++) if (samples[i] < m) m = samples[i];
+    return m;
+  }
+
+  T maximum() const {
+    if (count == 0) return 0;
+    T m = samples[0];
+    for (size_t i = 1; i < count; i++) if (samples[i] > m) m = samples[i];
+    return m;
+  }
+
+  float mean() const {
+    if (count == 0) return 0;
+    double sum = 0;
+    for (size_t i = 0; i < count; i++) sum += samples[i];
+    return (float)(sum / count);
+  }
+
+  // Perzentil (0-100) über eine sortierte Kopie auf dem Stack.
+  // Insertion Sort reicht für die kleinen Fenstergrößen völlig aus.
+  T percentile(uint8_t p) const {
+    if (count == 0) return 0;
+    T sorted[N];
+    for (size_t i = 0; i < count; i++) {
+      T v = samples[i];
+      size_t j = i;
+      while (j > 0 && sorted[j - 1] > v) {
+        sorted[j] = sorted[j - 1];
+        j--;
+      }
+      sorted[j] = v;
+    }
+    size_t idx = ((size_t)p * (count - 1) + 50) / 100;
+    return sorted[idx];
+  }
+
+  // Schreibt die Aggregate in ein JSON-Objekt.
+  // "n" = Werte im Fenster (Basis der Statistik), "total" = alle Werte seit dem Start
+  void toJson(JsonObject obj) const {
+    obj["n"] = count;
+    obj["total"] = total;
+    obj["min"] = minimum();
+    obj["max"] = maximum();
+    obj["mean"] = mean();
+    obj["p50"] = percentile(50);
+    obj["p95"] = percentile(95);
+    obj["p99"] = percentile(99);
+  }
+
+  // Kompakte Variante für periodische Meldungen (nur min/max/mean/p95, "n" wie oben)
+  void summaryToJson(JsonObject obj) const {
+    obj["n"] = count;
+    obj["min"] = minimum();
+    obj["max"] = maximum();
+    obj["mean"] = mean();
+    obj["p95"] = percentile(95);
+  }
+};
+
+#endif // SAMPLE_WINDOW_H
@@ -0,0 +1,357 @@
+#ifndef TLS_CLIENT_H
+#define TLS_CLIENT_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <errno.h>
+#include <WiFi.h>
+#include <WiFiClientSecure.h>
+#include <LittleFS.h>
+#include <lwip/sockets.h>
+#include <lwip/netdb.h>
+#include <mbedtls/ssl.h>
+#include <mbedtls/net_sockets.h>
+#include <mbedtls/error.h>
+#include "sample_window.h"
+
+#if __has_include(<esp_arduino_version.h>)
+#include <esp_arduino_version.h>
+#endif
+
+// ----------------------------------------
+// TLS für MQTT mit Session-Wiederaufnahme
+// Ein voller TLS-Handshake (Zertifikatsprüfung, ECDHE) kostet auf dem ESP32
+// mehrere hundert Millisekunden bis Sekunden CPU-Zeit. ResumableTlsClient
+// erweitert WiFiClientSecure um die Wiederaufnahme per Session-ID bzw.
+// Session-Ticket: Die Session des letzten Handshakes wird im RAM gehalten und
+// in LittleFS gespeichert, so dass auch der erste Connect nach einem Neustart
+// nur einen verkürzten Handshake braucht.
+// WiFiClientSecure bietet keinen Einstieg zwischen mbedtls_ssl_setup() und dem
+// Handshake. connect() baut die Verbindung deshalb selbst auf und nutzt dafür
+// den (protected) sslclient-Kontext; Lesen, Schreiben und stop() bleiben die
+// der Basisklasse (Layout von sslclient_context: arduino-esp32 2.0.x).
+// Aktivierung über MQTT_USE_TLS und MQTT_CA_CERT in secrets.h; main.cpp
+// bindet diese Datei nur dann ein. Der Core ist über die Plattform-Version in
+// platformio.ini festgelegt (espressif32 6.x = arduino-esp32 2.0.x).
+// ----------------------------------------
+
+// sslclient, ssl_init() und die Initialisierung der mbedtls-Kontexte sind
+// Interna von arduino-esp32 2.0.x; bei einem anderen Core lieber gar nicht bauen
+// als mit falschem Layout zur Laufzeit abstürzen.
+#if !defined(ESP_ARDUINO_VERSION_MAJOR) || ESP_ARDUINO_VERSION_MAJOR != 2
+#error "tls_client.h setzt arduino-esp32 2.0.x voraus (sslclient_context, ssl_init)"
+#endif
+
+#define TLS_SESSION_FILE "/tls_session.bin"
+#define TLS_SESSION_MAGIC 0x544c5331      // "TLS1"
+#define TLS_SESSION_MAX_LEN 3072          // Serialisierte Session inkl. Server-Zertifikat
+#define TLS_HOST_MAX_LEN 64
+#define TLS_HANDSHAKE_TIMEOUT_MS 10000
+#define TLS_CONNECT_TIMEOUT_S 10          // TCP-Verbindungsaufbau, über setTimeout() gesetzt
+#define TLS_WINDOW_SIZE 16
+
+struct TlsStats {
+  uint32_t handshakes = 0;         // Erfolgreiche Handshakes
+  uint32_t resumed = 0;            // davon verkürzt (Session wiederaufgenommen)
+  uint32_t failures = 0;           // Fehlgeschlagene Verbindungsversuche
+  int lastError = 0;               // Letzter mbedtls-Fehlercode
+  bool sessionFromFlash = false;   // Session beim Boot aus LittleFS geladen
+  uint32_t sessionSaves = 0;       // Schreibvorgänge nach LittleFS
+  SampleWindow<uint32_t, TLS_WINDOW_SIZE> tcpMs;       // TCP-Verbindungsaufbau
+  SampleWindow<uint32_t, TLS_WINDOW_SIZE> fullMs;      // Voller Handshake
+  SampleWindow<uint32_t, TLS_WINDOW_SIZE> resumedMs;   // Verkürzter Handshake
+};
+
+// Kopf der Session-Datei: die Session gilt nur für denselben Broker
+struct TlsSessionFileHeader {
+  uint32_t magic;
+  char host[TLS_HOST_MAX_LEN];
+  uint16_t port;
+  uint16_t length;                 // Länge der serialisierten Session
+};
+
+TlsStats tlsStats;
+uint8_t tlsSessionBuffer[TLS_SESSION_MAX_LEN]; // Statischer Puffer für Laden/Speichern
+
+class ResumableTlsClient : public WiFiClientSecure {
+public:
+  ResumableTlsClient() {
+    mbedtls_ssl_session_init(&_session);
+  }
+
+  // Socket für select() in waitForEvents(); WiFiClient::fd() kennt den TLS-Socket nicht
+  int socketFd() const {
+    return _connected ? sslclient->socket : -1;
+  }
+
+  int connect(IPAddress ip, uint16_t port) override {
+    char host[16];
+    snprintf(host, sizeof(host), "%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+    return connectTls(ip, host, port);
+  }
+
+  int connect(const char* host, uint16_t port) override {
+    IPAddress ip;
+    if (!WiFi.hostByName(host, ip)) return 0;
+    return connectTls(ip, host, port);
+  }
+
+  // ----------------------------------------
+  // Funktion: loadSession
+  // Lädt eine gespeicherte Session aus LittleFS (passend zu host/port)
+  // ----------------------------------------
+  void loadSession(const char* host, uint16_t port) {
+    File f = LittleFS.open(TLS_SESSION_FILE, "r");
+    if (!f) return;
+
+    TlsSessionFileHeader header;
+    bool valid = f.read((uint8_t*)&header, sizeof(header)) == sizeof(header) &&
+                 header.magic == TLS_SESSION_MAGIC && header.port == port &&
+                 strncmp(header.host, host, sizeof(header.host)) == 0 &&
+                 header.length <= sizeof(tlsSessionBuffer) &&
+                 f.read(tlsSessionBuffer, header.length) == header.length;
+    f.close();
+
+    if (valid && mbedtls_ssl_session_load(&_session, tlsSessionBuffer, header.length) == 0) {
+      _sessionValid = true;
+      tlsStats.sessionFromFlash = true;
+      Serial.println("TLS-Session aus LittleFS geladen.");
+    } else {
+      mbedtls_ssl_session_free(&_session);
+      mbedtls_ssl_session_init(&_session);
+    }
+  }
+
+private:
+  mbedtls_ssl_session _session;    // Session des letzten erfolgreichen Handshakes
+  bool _sessionValid = false;
+
+  // ----------------------------------------
+  // Funktion: connectTls
+  // TCP-Verbindung + TLS-Handshake mit angebotener Session.
+  // Entspricht start_ssl_client() aus ssl_client.cpp, ergänzt um
+  // mbedtls_ssl_set_session() vor und mbedtls_ssl_get_session() nach dem Handshake.
+  // ----------------------------------------
+  int connectTls(IPAddress ip, const char* host, uint16_t port) {
+    if (_connected) stop();
+
+    ssl_init(sslclient);
+    mbedtls_entropy_init(&sslclient->entropy_ctx);
+    mbedtls_x509_crt_init(&sslclient->ca_cert);
+    mbedtls_x509_crt_init(&sslclient->client_cert);
+    mbedtls_pk_init(&sslclient->client_key);
+
+    // --- TCP ---
+    uint32_t tcpStart = millis();
+    int fd = lwip_socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    sslclient->socket = fd;
+    if (fd < 0) return fail(0);
+
+    struct timeval tv;
+    tv.tv_sec = TLS_HANDSHAKE_TIMEOUT_MS / 1000;
+    tv.tv_usec = 0;
+    lwip_setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    lwip_setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = (uint32_t)ip;
+    addr.sin_port = htons(port);
+    // Nicht blockierend verbinden, damit ein nicht erreichbarer Broker die
+    // Hauptschleife höchstens _timeout (setTimeout()) aufhält
+    lwip_fcntl(fd, F_SETFL, lwip_fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    if (!connectSocket(fd, addr)) return fail(0);
+
+    int enable = 1;
+    lwip_setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+    lwip_setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &enable, sizeof(enable));
+    tlsStats.tcpMs.add(millis() - tcpStart);
+
+    // --- TLS-Konfiguration ---
+    int ret = mbedtls_ctr_drbg_seed(&sslclient->drbg_ctx, mbedtls_entropy_func,
+                                    &sslclient->entropy_ctx, (const unsigned char*)"mqtt", 4);
+    if (ret != 0) return fail(ret);
+
+    ret = mbedtls_ssl_config_defaults(&sslclient->ssl_conf, MBEDTLS_SSL_IS_CLIENT,
+                                      MBEDTLS_SSL_TRANSPORT_STREAM, MBEDTLS_SSL_PRESET_DEFAULT);
+    if (ret != 0) return fail(ret);
+
+    if (_CA_cert == nullptr) {
+      Serial.println("TLS: kein CA-Zertifikat gesetzt (MQTT_CA_CERT)");
+      return fail(MBEDTLS_ERR_X509_CERT_VERIFY_FAILED);
+    }
+    ret = mbedtls_x509_crt_parse(&sslclient->ca_cert, (const unsigned char*)_CA_cert, strlen(_CA_cert) + 1);
+    if (ret != 0) return fail(ret);
+
+    mbedtls_ssl_conf_authmode(&sslclient->ssl_conf, MBEDTLS_SSL_VERIFY_REQUIRED);
+    mbedtls_ssl_conf_ca_chain(&sslclient->ssl_conf, &sslclient->ca_cert, nullptr);
+    mbedtls_ssl_conf_rng(&sslclient->ssl_conf, mbedtls_ctr_drbg_random, &sslclient->drbg_ctx);
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+    mbedtls_ssl_conf_session_tickets(&sslclient->ssl_conf, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+#endif
+
+    ret = mbedtls_ssl_setup(&sslclient->ssl_ctx, &sslclient->ssl_conf);
+    if (ret != 0) return fail(ret);
+    ret = mbedtls_ssl_set_hostname(&sslclient->ssl_ctx, host);
+    if (ret != 0) return fail(ret);
+    mbedtls_ssl_set_bio(&sslclient->ssl_ctx, &sslclient->socket, mbedtls_net_send, mbedtls_net_recv, nullptr);
+
+    // Gespeicherte Session anbieten; lehnt der Server ab, folgt automatisch ein voller Handshake
+    if (_sessionValid) {
+      mbedtls_ssl_set_session(&sslclient->ssl_ctx, &_session);
+    }
+
+    // --- Handshake ---
+    uint32_t handshakeStart = millis();
+    while ((ret = mbedtls_ssl_handshake(&sslclient->ssl_ctx)) != 0) {
+      if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) return fail(ret);
+      if (millis() - handshakeStart > TLS_HANDSHAKE_TIMEOUT_MS) return fail(MBEDTLS_ERR_SSL_TIMEOUT);
+      waitForSocket(fd, ret == MBEDTLS_ERR_SSL_WANT_WRITE);
+    }
+    uint32_t handshakeMs = millis() - handshakeStart;
+
+    recordSession(host, port, handshakeMs);
+    _connected = true;
+    return 1;
+  }
+
+  // ----------------------------------------
+  // Funktion: connectSocket
+  // TCP-Connect auf einem nicht blockierenden Socket: wartet per select()
+  // höchstens _timeout ms auf den Verbindungsaufbau und prüft SO_ERROR.
+  // Der Socket bleibt nicht blockierend (Handshake und Lesen erwarten das).
+  // ----------------------------------------
+  bool connectSocket(int fd, const struct sockaddr_in& addr) {
+    if (lwip_connect(fd, (const struct sockaddr*)&addr, sizeof(addr)) == 0) return true;
+    if (errno != EINPROGRESS) {
+      Serial.print("TCP-Verbindung fehlgeschlagen, errno: ");
+      Serial.println(errno);
+      return false;
+    }
+
+    fd_set set;
+    FD_ZERO(&set);
+    FD_SET(fd, &set);
+    struct timeval tv;
+    tv.tv_sec = _timeout / 1000;
+    tv.tv_usec = (_timeout % 1000) * 1000;
+    int res = select(fd + 1, nullptr, &set, nullptr, &tv);
+    if (res <= 0) {
+      Serial.println(res == 0 ? "TCP-Verbindung: Zeitüberschreitung" : "TCP-Verbindung: select() fehlgeschlagen");
+      return false;
+    }
+
+    int socketError = 0;
+    socklen_t length = sizeof(socketError);
+    if (lwip_getsockopt(fd, SOL_SOCKET, SO_ERROR, &socketError, &length) != 0 || socketError != 0) {
+      Serial.print("TCP-Verbindung fehlgeschlagen, errno: ");
+      Serial.println(socketError);
+      return false;
+    }
+    return true;
+  }
+
+  // Wartet kurz auf den Socket statt aktiv zu pollen (CPU bleibt für den Handshake frei)
+  void waitForSocket(int fd, bool forWrite) {
+    fd_set set;
+    FD_ZERO(&set);
+    FD_SET(fd, &set);
+    struct timeval tv;
+    tv.tv_sec = 0;
+    tv.tv_usec = 50000;
+    select(fd + 1, forWrite ? nullptr : &set, forWrite ? &set : nullptr, nullptr, &tv);
+  }
+
+  // ----------------------------------------
+  // Funktion: recordSession
+  // Erkennt, ob die Session wiederaufgenommen wurde (gleiches Master-Secret),
+  // übernimmt die neue Session und speichert sie bei Änderung in LittleFS.
+  // ----------------------------------------
+  void recordSession(const char* host, uint16_t port, uint32_t handshakeMs) {
+    mbedtls_ssl_session fresh;
+    mbedtls_ssl_session_init(&fresh);
+    if (mbedtls_ssl_get_session(&sslclient->ssl_ctx, &fresh) != 0) {
+      mbedtls_ssl_session_free(&fresh);
+      return;
+    }
+
+    bool resumed = _sessionValid && memcmp(fresh.master, _session.master, sizeof(fresh.master)) == 0;
+    // Auch bei Wiederaufnahme kann der Server ein neues Ticket ausstellen
+    bool changed = !resumed;
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+    changed = changed || fresh.ticket_len != _session.ticket_len ||
+              (fresh.ticket_len > 0 && memcmp(fresh.ticket, _session.ticket, fresh.ticket_len) != 0);
+#endif
+
+    tlsStats.handshakes++;
+    if (resumed) {
+      tlsStats.resumed++;
+      tlsStats.resumedMs.add(handshakeMs);
+    } else {
+      tlsStats.fullMs.add(handshakeMs);
+    }
+    Serial.print(resumed ? "TLS-Handshake (wiederaufgenommen): " : "TLS-Handshake (voll): ");
+    Serial.print(handshakeMs);
+    Serial.println(" ms");
+
+    mbedtls_ssl_session_free(&_session);
+    _session = fresh; // Besitz der Zeiger (Ticket, Zertifikat) geht an _session über
+    _sessionValid = true;
+
+    if (changed) saveSession(host, port);
+  }
+
+  void saveSession(const char* host, uint16_t port) {
+    size_t length = 0;
+    if (mbedtls_ssl_session_save(&_session, tlsSessionBuffer, sizeof(tlsSessionBuffer), &length) != 0) {
+      Serial.println("TLS-Session zu groß zum Speichern.");
+      return;
+    }
+
+    TlsSessionFileHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = TLS_SESSION_MAGIC;
+    strlcpy(header.host, host, sizeof(header.host));
+    header.port = port;
+    header.length = length;
+
+    File f = LittleFS.open(TLS_SESSION_FILE, "w");
+    if (!f) return;
+    f.write((const uint8_t*)&header, sizeof(header));
+    f.write(tlsSessionBuffer, length);
+    f.close();
+    tlsStats.sessionSaves++;
+  }
+
+  int fail(int err) {
+    tlsStats.failures++;
+    tlsStats.lastError = err;
+    if (err != 0) {
+      char message[96];
+      mbedtls_strerror(err, message, sizeof(message));
+      Serial.print("TLS-Verbindung fehlgeschlagen: ");
+      Serial.println(message);
+    }
+    stop(); // Gibt Socket und mbedtls-Kontexte wieder frei
+    return 0;
+  }
+};
+
+// ----------------------------------------
+// Funktion: tlsStatsToJson
+// Schreibt die Handshake-Kennzahlen in ein JSON-Objekt (für den Heartbeat)
+// ----------------------------------------
+void tlsStatsToJson(JsonObject obj) {
+  obj["handshakes"] = tlsStats.handshakes;
+  obj["resumed"] = tlsStats.resumed;
+  obj["failures"] = tlsStats.failures;
+  obj["lastError"] = tlsStats.lastError;
+  obj["sessionFromFlash"] = tlsStats.sessionFromFlash;
+  obj["sessionSaves"] = tlsStats.sessionSaves;
+  tlsStats.tcpMs.summaryToJson(obj["tcpMs"].to<JsonObject>());
+  tlsStats.fullMs.summaryToJson(obj["fullMs"].to<JsonObject>());
+  tlsStats.resumedMs.summaryToJson(obj["resumedMs"].to<JsonObject>());
+}
+
+#endif // TLS_CLIENT_H
@@ -0,0 +1,510 @@
+#ifndef TRAFFIC_CAPTURE_H
+#define TRAFFIC_CAPTURE_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <LittleFS.h>
+#include "json_arena.h"      // jsonArena, MQTT_PAYLOAD_MAX_LEN
+#include "sample_window.h"
+
+// ----------------------------------------
+// Aufzeichnung und Wiedergabe des MQTT-Verkehrs (Lasttests / Regressionen)
+// Eingehende Nachrichten werden mit ihrem zeitlichen Abstand in einen Ring aus
+// CAPTURE_SEGMENT_COUNT Dateien auf LittleFS geschrieben. Ist der Ring voll,
+// wird das älteste Segment überschrieben.
+// Record-Format (Little Endian): [u32 deltaUs][u8 topicLen][u16 payloadLen][topic][payload]
+// Topics des eigenen Geräts werden als "~/<suffix>" gespeichert, damit eine
+// Aufzeichnung auch auf einem anderen Gerät abgespielt werden kann.
+// Records landen zuerst in einem RAM-Puffer; geschrieben wird aus loop(),
+// damit Flash-Zugriffe die Verarbeitung im Callback nicht verfälschen.
+// Während Export und Wiedergabe ruht die Aufzeichnung.
+// ----------------------------------------
+
+#define CAPTURE_SEGMENT_COUNT 8
+#define CAPTURE_SEGMENT_SIZE 8192         // Bytes pro Segmentdatei
+#define CAPTURE_STAGING_SIZE 4096         // RAM-Puffer vor dem Schreiben ins Flash
+#define CAPTURE_FLUSH_INTERVAL_MS 1000    // Spätestens nach dieser Zeit wird der Puffer geschrieben
+#define CAPTURE_RECORD_HEADER_LEN 7       // u32 deltaUs + u8 topicLen + u16 payloadLen
+#define CAPTURE_TOPIC_MAX_LEN 64
+#define CAPTURE_EXPORT_HEADER_LEN 8       // u32 offset + u32 Gesamtgröße vor jedem Export-Chunk
+#define CAPTURE_EXPORT_CHUNK 1024         // Nutzdaten pro Export-Chunk
+#define CAPTURE_META_FILE "/capture.json"
+#define CAPTURE_DEVICE_PREFIX "~/"
+
+// Wird in main.cpp definiert (Wiedergabe speist Nachrichten direkt in den Callback)
+void callback(char* topic, byte* payload, unsigned int length);
+
+struct TrafficCapture {
+  bool recording = false;
+  bool resumeRecording = false;     // Nach Export/Wiedergabe wieder aufzeichnen
+  char devicePrefix[CAPTURE_TOPIC_MAX_LEN];  // "esp32/<id>/"
+  size_t devicePrefixLen = 0;
+
+  // Ring
+  int segment = 0;                  // Segment, in das geschrieben wird (das nächste ist das älteste)
+  uint32_t segmentSizes[CAPTURE_SEGMENT_COUNT] = {0};  // Bereits geschriebene Bytes pro Segment
+  uint8_t staging[CAPTURE_STAGING_SIZE];
+  size_t stagingLen = 0;
+  uint32_t lastFlushAt = 0;         // millis()
+  bool haveLastRecord = false;
+  uint32_t lastRecordAt = 0;        // micros() des letzten Records
+
+  uint32_t records = 0;             // Aufgezeichnete Nachrichten seit dem Start
+  uint32_t dropped = 0;             // Zu große Nachrichten (nicht aufgezeichnet)
+  SampleWindow<uint32_t, 16> flushUs;  // Dauer eines Schreibvorgangs ins Flash
+
+  // Export
+  bool exporting = false;
+  uint32_t exportOffset = 0;
+  uint32_t exportTotal = 0;
+
+  // Wiedergabe
+  bool replaying = false;
+  float replaySpeed = 1.0f;         // 0 = so schnell wie möglich
+  bool replaySettings = false;      // settings/set mit abspielen (verändert den Flash-Inhalt)
+  uint32_t replayOffset = 0;
+  uint32_t replayTotal = 0;
+  uint32_t replayed = 0;
+  uint32_t replaySkipped = 0;
+  uint32_t replayStartedAt = 0;     // millis()
+  uint32_t replayDurationMs = 0;
+  bool replayPending = false;       // Nächster Record ist geladen und wartet auf seinen Zeitpunkt
+  bool replayFirst = true;
+  uint32_t replayDueAt = 0;         // micros()
+  char replayTopic[CAPTURE_TOPIC_MAX_LEN];
+  uint8_t replayPayload[MQTT_PAYLOAD_MAX_LEN];
+  uint16_t replayLength = 0;
+  bool replayDispatching = false;   // callback() läuft gerade für einen abgespielten Record
+
+  // Lesezugriff (Export/Wiedergabe)
+  File readFile;
+  int readSegment = -1;
+};
+
+TrafficCapture trafficCapture;
+
+void captureSegmentPath(int segment, char* path, size_t len) {
+  snprintf(path, len, "/cap%d.bin", segment);
+}
+
+bool saveCaptureMeta() {
+  JsonDocument doc(&jsonArena);
+  doc["segment"] = trafficCapture.segment;
+
+  File file = LittleFS.open(CAPTURE_META_FILE, "w");
+  if (!file) {
+    Serial.println("Fehler beim Öffnen der Capture-Metadaten zum Schreiben!");
+    return false;
+  }
+  size_t bytesWritten = serializeJson(doc, file);
+  file.close();
+  return bytesWritten > 0;
+}
+
+// ----------------------------------------
+// Funktion: initTrafficCapture
+// Übernimmt den Ring vom letzten Boot (Aufzeichnung bleibt für den Export
+// erhalten, wird aber nicht automatisch fortgesetzt).
+// Muss nach initLittleFS() aufgerufen werden.
+// ----------------------------------------
+void initTrafficCapture(const char* deviceId) {
+  snprintf(trafficCapture.devicePrefix, sizeof(trafficCapture.devicePrefix), "esp32/%s/", deviceId);
+  trafficCapture.devicePrefixLen = strlen(trafficCapture.devicePrefix);
+
+  if (LittleFS.exists(CAPTURE_META_FILE)) {
+    File file = LittleFS.open(CAPTURE_META_FILE, "r");
+    JsonDocument doc(&jsonArena);
+    if (file && !deserializeJson(doc, file)) {
+      trafficCapture.segment = (doc["segment"] | 0) % CAPTURE_SEGMENT_COUNT;
+    }
+    file.close();
+  }
+
+  char path[16];
+  for (int i = 0; i < CAPTURE_SEGMENT_COUNT; i++) {
+    captureSegmentPath(i, path, sizeof(path));
+    trafficCapture.segmentSizes[i] = 0;
+    if (!LittleFS.exists(path)) continue;
+    File file = LittleFS.open(path, "r");
+    if (file) trafficCapture.segmentSizes[i] = file.size();
+    file.close();
+  }
+}
+
+// Gesamtgröße der Aufzeichnung im Flash
+uint32_t captureStoredBytes() {
+  uint32_t total = 0;
+  for (int i = 0; i < CAPTURE_SEGMENT_COUNT; i++) total += trafficCapture.segmentSizes[i];
+  return total;
+}
+
+// ----------------------------------------
+// Funktion: captureFlush
+// Schreibt den RAM-Puffer an das aktuelle Segment an
+// ----------------------------------------
+void captureFlush() {
+  trafficCapture.lastFlushAt = millis();
+  if (trafficCapture.stagingLen == 0) return;
+
+  uint32_t startedAt = micros();
+  char path[16];
+  captureSegmentPath(trafficCapture.segment, path, sizeof(path));
+  File file = LittleFS.open(path, "a");
+  if (!file) {
+    Serial.println("Fehler beim Öffnen des Capture-Segments!");
+    trafficCapture.stagingLen = 0;
+    return;
+  }
+  trafficCapture.segmentSizes[trafficCapture.segment] += file.write(trafficCapture.staging, trafficCapture.stagingLen);
+  file.close();
+  trafficCapture.stagingLen = 0;
+  trafficCapture.flushUs.add(micros() - startedAt);
+}
+
+// Nächstes (ältestes) Segment leeren und zum aktuellen machen
+void captureNextSegment() {
+  trafficCapture.segment = (trafficCapture.segment + 1) % CAPTURE_SEGMENT_COUNT;
+  char path[16];
+  captureSegmentPath(trafficCapture.segment, path, sizeof(path));
+  LittleFS.remove(path);
+  trafficCapture.segmentSizes[trafficCapture.segment] = 0;
+  saveCaptureMeta();
+}
+
+// ----------------------------------------
+// Funktion: captureMessage
+// Wird im Callback vor dem Handler aufgerufen (das Payload liegt noch
+// unverändert im Puffer des PubSubClient). Kopiert die Nachricht nur in den
+// RAM-Puffer; nur beim Segmentwechsel (alle 8 KB) wird direkt geschrieben.
+// ----------------------------------------
+void captureMessage(const char* topic, const byte* payload, unsigned int length) {
+  if (!trafficCapture.recording) return;
+  uint32_t now = micros();
+
+  const char* suffix = nullptr;
+  size_t topicLen = strlen(topic);
+  if (strncmp(topic, trafficCapture.devicePrefix, trafficCapture.devicePrefixLen) == 0) {
+    suffix = topic + trafficCapture.devicePrefixLen;
+    topicLen = sizeof(CAPTURE_DEVICE_PREFIX) - 1 + strlen(suffix);
+  }
+
+  size_t recordLen = CAPTURE_RECORD_HEADER_LEN + topicLen + length;
+  if (topicLen >= CAPTURE_TOPIC_MAX_LEN || length > MQTT_PAYLOAD_MAX_LEN || recordLen > CAPTURE_STAGING_SIZE) {
+    trafficCapture.dropped++;
+    return;
+  }
+
+  // Records werden nicht über Segmentgrenzen geteilt
+  if (trafficCapture.segmentSizes[trafficCapture.segment] + trafficCapture.stagingLen + recordLen > CAPTURE_SEGMENT_SIZE) {
+    captureFlush();
+    captureNextSegment();
+  } else if (trafficCapture.stagingLen + recordLen > CAPTURE_STAGING_SIZE) {
+    captureFlush();
+  }
+
+  uint32_t deltaUs = trafficCapture.haveLastRecord ? now - trafficCapture.lastRecordAt : 0;
+  trafficCapture.haveLastRecord = true;
+  trafficCapture.lastRecordAt = now;
+
+  uint8_t* out = trafficCapture.staging + trafficCapture.stagingLen;
+  uint8_t topicLen8 = topicLen;
+  uint16_t payloadLen = length;
+  memcpy(out, &deltaUs, 4);          // ESP32 ist Little Endian
+  memcpy(out + 4, &topicLen8, 1);
+  memcpy(out + 5, &payloadLen, 2);
+  out += CAPTURE_RECORD_HEADER_LEN;
+  if (suffix != nullptr) {
+    memcpy(out, CAPTURE_DEVICE_PREFIX, sizeof(CAPTURE_DEVICE_PREFIX) - 1);
+    memcpy(out + sizeof(CAPTURE_DEVICE_PREFIX) - 1, suffix, topicLen - (sizeof(CAPTURE_DEVICE_PREFIX) - 1));
+  } else {
+    memcpy(out, topic, topicLen);
+  }
+  memcpy(out + topicLen, payload, length);
+
+  trafficCapture.stagingLen += recordLen;
+  trafficCapture.records++;
+}
+
+// ----------------------------------------
+// Funktion: captureStart / captureStop
+// Start verwirft die bisherige Aufzeichnung und beginnt bei Segment 0
+// ----------------------------------------
+bool captureStart() {
+  if (trafficCapture.exporting || trafficCapture.replaying) return false;
+
+  char path[16];
+  for (int i = 0; i < CAPTURE_SEGMENT_COUNT; i++) {
+    captureSegmentPath(i, path, sizeof(path));
+    LittleFS.remove(path);
+    trafficCapture.segmentSizes[i] = 0;
+  }
+  trafficCapture.segment = 0;
+  trafficCapture.stagingLen = 0;
+  trafficCapture.records = 0;
+  trafficCapture.dropped = 0;
+  trafficCapture.flushUs.clear();
+  trafficCapture.haveLastRecord = false;
+  trafficCapture.lastFlushAt = millis();
+  saveCaptureMeta();
+  trafficCapture.recording = true;
+  return true;
+}
+
+void captureStop() {
+  captureFlush();
+  trafficCapture.recording = false;
+  trafficCapture.resumeRecording = false;
+}
+
+// ----------------------------------------
+// Funktion: captureRead
+// Liest ab einer Position im Datenstrom (ältestes Segment zuerst).
+// Die Datei des zuletzt gelesenen Segments bleibt geöffnet.
+// ----------------------------------------
+size_t captureRead(uint32_t offset, uint8_t* buffer, size_t len) {
+  size_t done = 0;
+  for (int k = 1; k <= CAPTURE_SEGMENT_COUNT && done < len; k++) {
+    int seg = (trafficCapture.segment + k) % CAPTURE_SEGMENT_COUNT;
+    uint32_t size = trafficCapture.segmentSizes[seg];
+    if (offset >= size) {
+      offset -= size;
+      continue;
+    }
+
+    if (trafficCapture.readSegment != seg) {
+      if (trafficCapture.readFile) trafficCapture.readFile.close();
+      char path[16];
+      captureSegmentPath(seg, path, sizeof(path));
+      trafficCapture.readFile = LittleFS.open(path, "r");
+      trafficCapture.readSegment = seg;
+    }
+    if (!trafficCapture.readFile || !trafficCapture.readFile.seek(offset)) break;
+
+    size_t want = len - done < size - offset ? len - done : size - offset;
+    size_t n = trafficCapture.readFile.read(buffer + done, want);
+    done += n;
+    if (n < want) break;
+    offset = 0;
+  }
+  return done;
+}
+
+// Aufzeichnung für Export/Wiedergabe anhalten, Puffer schreiben
+void capturePauseForRead() {
+  captureFlush();
+  trafficCapture.resumeRecording = trafficCapture.recording;
+  trafficCapture.recording = false;
+}
+
+void captureResumeAfterRead() {
+  if (trafficCapture.readFile) trafficCapture.readFile.close();
+  trafficCapture.readSegment = -1;
+  trafficCapture.recording = trafficCapture.resumeRecording;
+  trafficCapture.resumeRecording = false;
+  trafficCapture.haveLastRecord = false;  // Die Pause nicht als Wartezeit aufzeichnen
+}
+
+// ----------------------------------------
+// Funktion: captureStartExport / captureNextExportChunk / captureExportAdvance
+// Der Export läuft schrittweise aus loop() (ein Chunk pro Durchlauf).
+// Chunk: [u32 offset][u32 Gesamtgröße][Daten]; der letzte Chunk endet bei der Gesamtgröße.
+// ----------------------------------------
+bool captureStartExport() {
+  if (trafficCapture.exporting || trafficCapture.replaying) return false;
+  capturePauseForRead();
+  trafficCapture.exportOffset = 0;
+  trafficCapture.exportTotal = captureStoredBytes();
+  trafficCapture.exporting = true;
+  return true;
+}
+
+// Füllt buffer mit Header + Daten; gibt die Länge des Chunks zurück (dataLen = Nutzdaten)
+size_t captureNextExportChunk(uint8_t* buffer, size_t len, size_t* dataLen) {
+  uint32_t offset = trafficCapture.exportOffset;
+  uint32_t total = trafficCapture.exportTotal;
+  memcpy(buffer, &offset, 4);
+  memcpy(buffer + 4, &total, 4);
+
+  size_t maxData = len - CAPTURE_EXPORT_HEADER_LEN;
+  if (maxData > CAPTURE_EXPORT_CHUNK) maxData = CAPTURE_EXPORT_CHUNK;
+  if (maxData > total - offset) maxData = total - offset;
+  *dataLen = captureRead(offset, buffer + CAPTURE_EXPORT_HEADER_LEN, maxData);
+  return CAPTURE_EXPORT_HEADER_LEN + *dataLen;
+}
+
+// Nach erfolgreichem Publish aufrufen. Gibt true zurück, wenn der Export fertig ist.
+bool captureExportAdvance(size_t dataLen) {
+  trafficCapture.exportOffset += dataLen;
+  // Lesefehler (dataLen == 0 vor dem Ende) beendet den Export ebenfalls
+  if (trafficCapture.exportOffset < trafficCapture.exportTotal && dataLen > 0) return false;
+  trafficCapture.exporting = false;
+  captureResumeAfterRead();
+  return true;
+}
+
+// ----------------------------------------
+// Funktion: captureStartReplay
+// Spielt die Aufzeichnung in den MQTT-Callback ein. speed skaliert die
+// aufgezeichneten Abstände (2 = doppelt so schnell, 0 = ohne Pausen).
+// settings/set wird nur mit includeSettings abgespielt.
+// ----------------------------------------
+bool captureStartReplay(float speed, bool includeSettings) {
+  if (trafficCapture.exporting || trafficCapture.replaying) return false;
+  capturePauseForRead();
+
+  trafficCapture.replayTotal = captureStoredBytes();
+  if (trafficCapture.replayTotal == 0) {
+    captureResumeAfterRead();
+    return false;
+  }
+
+  trafficCapture.replaySpeed = speed < 0 ? 0 : speed;
+  trafficCapture.replaySettings = includeSettings;
+  trafficCapture.replayOffset = 0;
+  trafficCapture.replayed = 0;
+  trafficCapture.replaySkipped = 0;
+  trafficCapture.replayPending = false;
+  trafficCapture.replayFirst = true;
+  trafficCapture.replayStartedAt = millis();
+  trafficCapture.replayDurationMs = 0;
+  trafficCapture.replaying = true;
+  return true;
+}
+
+// Lädt den nächsten Record in den Wiedergabe-Puffer und berechnet seinen Zeitpunkt
+bool captureLoadReplayRecord() {
+  uint8_t header[CAPTURE_RECORD_HEADER_LEN];
+  if (trafficCapture.replayOffset + CAPTURE_RECORD_HEADER_LEN > trafficCapture.replayTotal) return false;
+  if (captureRead(trafficCapture.replayOffset, header, sizeof(header)) != sizeof(header)) return false;
+
+  uint32_t deltaUs;
+  uint8_t topicLen;
+  uint16_t payloadLen;
+  memcpy(&deltaUs, header, 4);
+  memcpy(&topicLen, header + 4, 1);
+  memcpy(&payloadLen, header + 5, 2);
+
+  uint32_t offset = trafficCapture.replayOffset + CAPTURE_RECORD_HEADER_LEN;
+  if (topicLen == 0 || topicLen >= CAPTURE_TOPIC_MAX_LEN || payloadLen > MQTT_PAYLOAD_MAX_LEN ||
+      offset + topicLen + payloadLen > trafficCapture.replayTotal) {
+    Serial.println("Capture: ungültiger Record, Wiedergabe beendet");
+    return false;
+  }
+
+  // Topic lesen, "~/" wieder auf das eigene Gerät abbilden
+  char topic[CAPTURE_TOPIC_MAX_LEN];
+  if (captureRead(offset, (uint8_t*)topic, topicLen) != topicLen) return false;
+  topic[topicLen] = '\0';
+  if (strncmp(topic, CAPTURE_DEVICE_PREFIX, sizeof(CAPTURE_DEVICE_PREFIX) - 1) == 0) {
+    snprintf(trafficCapture.replayTopic, sizeof(trafficCapture.replayTopic), "%s%s",
+             trafficCapture.devicePrefix, topic + sizeof(CAPTURE_DEVICE_PREFIX) - 1);
+  } else {
+    strlcpy(trafficCapture.replayTopic, topic, sizeof(trafficCapture.replayTopic));
+  }
+
+  offset += topicLen;
+  if (captureRead(offset, trafficCapture.replayPayload, payloadLen) != payloadLen) return false;
+  trafficCapture.replayLength = payloadLen;
+  trafficCapture.replayOffset = offset + payloadLen;
+
+  // Feste Zeitachse: Verspätungen einzelner Nachrichten verschieben die folgenden nicht
+  if (trafficCapture.replayFirst) {
+    trafficCapture.replayDueAt = micros();
+    trafficCapture.replayFirst = false;
+  } else if (trafficCapture.replaySpeed > 0) {
+    trafficCapture.replayDueAt += (uint32_t)(deltaUs / trafficCapture.replaySpeed);
+  }
+  trafficCapture.replayPending = true;
+  return true;
+}
+
+// ----------------------------------------
+// Funktion: captureReplayPoll
+// Wird aus loop() aufgerufen und gibt höchstens eine fällige Nachricht an den
+// Callback. Gibt true zurück, wenn die Wiedergabe gerade beendet wurde.
+// ----------------------------------------
+bool captureReplayPoll() {
+  if (!trafficCapture.replaying) return false;
+
+  if (!trafficCapture.replayPending && !captureLoadReplayRecord()) {
+    trafficCapture.replaying = false;
+    trafficCapture.replayDurationMs = millis() - trafficCapture.replayStartedAt;
+    captureResumeAfterRead();
+    return true;
+  }
+
+  if (trafficCapture.replaySpeed > 0 && (int32_t)(micros() - trafficCapture.replayDueAt) < 0) return false;
+  trafficCapture.replayPending = false;
+
+  const char* topic = trafficCapture.replayTopic;
+  if (!trafficCapture.replaySettings &&
+      strncmp(topic, trafficCapture.devicePrefix, trafficCapture.devicePrefixLen) == 0 &&
+      strcmp(topic + trafficCapture.devicePrefixLen, "settings/set") == 0) {
+    trafficCapture.replaySkipped++;
+    return false;
+  }
+
+  // Kennzeichnet den Aufruf als Wiedergabe: nur diese Nachrichten gehen ins Profil
+  trafficCapture.replayDispatching = true;
+  callback(trafficCapture.replayTopic, trafficCapture.replayPayload, trafficCapture.replayLength);
+  trafficCapture.replayDispatching = false;
+  trafficCapture.replayed++;
+  return false;
+}
+
+// ----------------------------------------
+// Funktion: captureMillisUntilNextTask
+// Wartezeit bis zum nächsten Flush, Export-Chunk oder Wiedergabe-Zeitpunkt
+// (für waitForEvents). UINT32_MAX = nichts zu tun.
+// ----------------------------------------
+uint32_t captureMillisUntilNextTask(uint32_t now) {
+  if (trafficCapture.exporting) return 0;
+  if (trafficCapture.replaying) {
+    if (!trafficCapture.replayPending || trafficCapture.replaySpeed == 0) return 0;
+    int32_t remainingUs = (int32_t)(trafficCapture.replayDueAt - micros());
+    return remainingUs <= 0 ? 0 : remainingUs / 1000;
+  }
+  if (trafficCapture.stagingLen == 0) return UINT32_MAX;
+  uint32_t elapsed = now - trafficCapture.lastFlushAt;
+  return elapsed >= CAPTURE_FLUSH_INTERVAL_MS ? 0 : CAPTURE_FLUSH_INTERVAL_MS - elapsed;
+}
+
+// Aus loop(): Puffer schreiben, wenn halb voll oder das Intervall abgelaufen ist
+void captureFlushIfDue(uint32_t now) {
+  if (trafficCapture.stagingLen == 0) return;
+  if (trafficCapture.stagingLen >= CAPTURE_STAGING_SIZE / 2 ||
+      now - trafficCapture.lastFlushAt >= CAPTURE_FLUSH_INTERVAL_MS) {
+    captureFlush();
+  }
+}
+
+// ----------------------------------------
+// Funktion: captureStatusToJson
+// Schreibt den Zustand von Aufzeichnung, Export und Wiedergabe
+// ----------------------------------------
+void captureStatusToJson(JsonObject obj) {
+  obj["recording"] = trafficCapture.recording;
+  obj["records"] = trafficCapture.records;
+  obj["dropped"] = trafficCapture.dropped;
+  obj["bytes"] = captureStoredBytes() + trafficCapture.stagingLen;
+  obj["segment"] = trafficCapture.segment;
+  trafficCapture.flushUs.summaryToJson(obj["flushUs"].to<JsonObject>());
+
+  obj["exporting"] = trafficCapture.exporting;
+  if (trafficCapture.exporting) {
+    obj["exportOffset"] = trafficCapture.exportOffset;
+    obj["exportTotal"] = trafficCapture.exportTotal;
+  }
+
+  JsonObject replay = obj["replay"].to<JsonObject>();
+  replay["active"] = trafficCapture.replaying;
+  replay["speed"] = trafficCapture.replaySpeed;
+  replay["offset"] = trafficCapture.replayOffset;
+  replay["total"] = trafficCapture.replayTotal;
+  replay["replayed"] = trafficCapture.replayed;
+  replay["skipped"] = trafficCapture.replaySkipped;
+  replay["durationMs"] = trafficCapture.replaying ? millis() - trafficCapture.replayStartedAt
+                                                  : trafficCapture.replayDurationMs;
+}
+
+#endif // TRAFFIC_CAPTURE_H
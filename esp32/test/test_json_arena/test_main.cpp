@@ -0,0 +1,169 @@
+// ----------------------------------------
+// Host-Tests für die JSON-Arena (json_arena.h)
+// Ausführen mit: pio test -e native
+// Geprüft werden Ausrichtung, Rückgabe des obersten Blocks, Zurücksetzen,
+// Ausweichen auf den Heap bei Überlauf und das Zusammenspiel mit JsonDocument.
+// ----------------------------------------
+
+#include <string>
+#include <unity.h>
+#include "json_arena.h"
+
+void setUp() {}
+void tearDown() {}
+
+static bool isAligned(void* ptr) {
+  return ((uintptr_t)ptr & 7) == 0;
+}
+
+void test_allocations_are_aligned() {
+  JsonArena arena;
+  void* a = arena.allocate(1);
+  void* b = arena.allocate(3);
+  void* c = arena.allocate(13);
+  TEST_ASSERT_TRUE(isAligned(a));
+  TEST_ASSERT_TRUE(isAligned(b));
+  TEST_ASSERT_TRUE(isAligned(c));
+  // Header (8) + auf 8 aufgerundete Nutzdaten
+  TEST_ASSERT_EQUAL_UINT32(16 + 16 + 24, arena.used());
+  arena.deallocate(c);
+  arena.deallocate(b);
+  arena.deallocate(a);
+}
+
+void test_top_block_is_returned_immediately() {
+  JsonArena arena;
+  void* a = arena.allocate(32);
+  size_t afterA = arena.used();
+  void* b = arena.allocate(64);
+  arena.deallocate(b);
+  TEST_ASSERT_EQUAL_UINT32(afterA, arena.used());
+  arena.deallocate(a);
+  TEST_ASSERT_EQUAL_UINT32(0, arena.used());
+}
+
+void test_resets_when_all_blocks_are_freed() {
+  JsonArena arena;
+  void* a = arena.allocate(100);
+  void* b = arena.allocate(200);
+  void* c = arena.allocate(300);
+
+  // Nicht in umgekehrter Reihenfolge: die Arena bleibt belegt, bis alles frei ist
+  arena.deallocate(a);
+  TEST_ASSERT_NOT_EQUAL(0, arena.used());
+  arena.deallocate(c);
+  arena.deallocate(b);
+  TEST_ASSERT_EQUAL_UINT32(0, arena.used());
+  TEST_ASSERT_EQUAL_UINT32(0, arena.heapFallbacks());
+
+  // Spitzenwert bleibt über das Zurücksetzen hinweg erhalten
+  TEST_ASSERT_TRUE(arena.peakUsed() >= 600);
+}
+
+void test_overflow_falls_back_to_heap() {
+  JsonArena arena;
+  void* a = arena.allocate(JSON_ARENA_SIZE / 2);
+  size_t usedBefore = arena.used();
+
+  void* big = arena.allocate(JSON_ARENA_SIZE);
+  TEST_ASSERT_NOT_NULL(big);
+  TEST_ASSERT_EQUAL_UINT32(1, arena.heapFallbacks());
+  TEST_ASSERT_EQUAL_UINT32(usedBefore, arena.used());
+
+  // Heap-Block wird über free() zurückgegeben und zählt nicht als Arena-Block
+  memset(big, 0xAA, JSON_ARENA_SIZE);
+  arena.deallocate(big);
+  TEST_ASSERT_EQUAL_UINT32(usedBefore, arena.used());
+
+  arena.deallocate(a);
+  TEST_ASSERT_EQUAL_UINT32(0, arena.used());
+}
+
+void test_reallocate_grows_top_block_in_place() {
+  JsonArena arena;
+  char* a = (char*)arena.allocate(16);
+  strcpy(a, "arena");
+  char* grown = (char*)arena.reallocate(a, 256);
+  TEST_ASSERT_EQUAL_PTR(a, grown);
+  TEST_ASSERT_EQUAL_STRING("arena", grown);
+  TEST_ASSERT_EQUAL_UINT32(8 + 256, arena.used());
+  arena.deallocate(grown);
+  TEST_ASSERT_EQUAL_UINT32(0, arena.used());
+}
+
+void test_reallocate_copies_inner_block() {
+  JsonArena arena;
+  char* a = (char*)arena.allocate(16);
+  void* b = arena.allocate(16);
+  strcpy(a, "inner");
+  char* moved = (char*)arena.reallocate(a, 64);
+  TEST_ASSERT_TRUE(moved != a);
+  TEST_ASSERT_TRUE(isAligned(moved));
+  TEST_ASSERT_EQUAL_STRING("inner", moved);
+  arena.deallocate(b);
+  arena.deallocate(moved);
+  TEST_ASSERT_EQUAL_UINT32(0, arena.used());
+}
+
+void test_peak_since_mark() {
+  JsonArena arena;
+  void* a = arena.allocate(1000);
+  arena.deallocate(a);
+  arena.markPeak();
+  TEST_ASSERT_EQUAL_UINT32(0, arena.peakSinceMark());
+  void* b = arena.allocate(100);
+  TEST_ASSERT_EQUAL_UINT32(8 + 104, arena.peakSinceMark());
+  arena.deallocate(b);
+}
+
+// Pro Nachricht: Dokument parsen, verwenden, zerstören -> Arena wieder leer
+void test_documents_reset_arena_between_messages() {
+  JsonArena arena;
+  for (int i = 0; i < 3; i++) {
+    JsonDocument doc(&arena);
+    const char json[] = "{\"cid\":\"abc\",\"gpios\":[{\"pinNumber\":4,\"state\":1}]}";
+    TEST_ASSERT_FALSE(deserializeJson(doc, json));
+    TEST_ASSERT_EQUAL_INT(4, doc["gpios"][0]["pinNumber"].as<int>());
+    TEST_ASSERT_NOT_EQUAL(0, arena.used());
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, arena.used());
+  TEST_ASSERT_EQUAL_UINT32(0, arena.heapFallbacks());
+}
+
+void test_document_larger_than_arena_still_works() {
+  JsonArena arena;
+  {
+    JsonDocument doc(&arena);
+    JsonArray values = doc["values"].to<JsonArray>();
+    for (int i = 0; i < 4000; i++) values.add(i);
+    TEST_ASSERT_EQUAL_INT(3999, doc["values"][3999].as<int>());
+    TEST_ASSERT_TRUE(arena.heapFallbacks() > 0);
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, arena.used());
+}
+
+void test_serialize_payload_rejects_oversized_document() {
+  JsonDocument doc(&jsonArena);
+  doc["data"] = std::string(MQTT_PAYLOAD_MAX_LEN, 'x');
+  TEST_ASSERT_EQUAL_UINT32(0, serializePayload(doc));
+  TEST_ASSERT_EQUAL_STRING("", mqttPayload);
+
+  doc["data"] = "ok";
+  TEST_ASSERT_EQUAL_UINT32(strlen("{\"data\":\"ok\"}"), serializePayload(doc));
+  TEST_ASSERT_EQUAL_STRING("{\"data\":\"ok\"}", mqttPayload);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_allocations_are_aligned);
+  RUN_TEST(test_top_block_is_returned_immediately);
+  RUN_TEST(test_resets_when_all_blocks_are_freed);
+  RUN_TEST(test_overflow_falls_back_to_heap);
+  RUN_TEST(test_reallocate_grows_top_block_in_place);
+  RUN_TEST(test_reallocate_copies_inner_block);
+  RUN_TEST(test_peak_since_mark);
+  RUN_TEST(test_documents_reset_arena_between_messages);
+  RUN_TEST(test_document_larger_than_arena_still_works);
+  RUN_TEST(test_serialize_payload_rejects_oversized_document);
+  return UNITY_END();
+}
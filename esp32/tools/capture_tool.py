@@ -0,0 +1,284 @@
+#!/usr/bin/env python3
+"""
+Aufzeichnung und Wiedergabe des MQTT-Verkehrs für reproduzierbare Lasttests.
+
+Das Gerät zeichnet eingehende Nachrichten mit ihren zeitlichen Abständen auf
+LittleFS auf (traffic_capture.h). Dieses Skript steuert die Aufzeichnung,
+exportiert sie in eine Datei und spielt sie erneut ab:
+
+- replay:              Records werden über den Broker an ein Gerät gesendet
+                       (aufgezeichnetes Tempo oder --speed N), anschließend werden
+                       Handler-Profil und Latenz-Statistik des Geräts ausgegeben.
+- replay --on-device:  Das Gerät spielt seine eigene Aufzeichnung direkt in den
+                       Callback ein (ohne Netzwerk-Jitter, deterministisch).
+
+Vor/nach einer Firmware-Änderung mit derselben Aufzeichnung ausführen und die
+Profile (Laufzeit pro Handler, Arena-Spitze, Heap-Differenz) vergleichen.
+
+Beispiel:
+    pip install paho-mqtt
+    python tools/capture_tool.py --host 192.168.1.100 --device A1B2C3D4E5F6 start
+    python tools/capture_tool.py --host 192.168.1.100 --device A1B2C3D4E5F6 export -o last.cap
+    python tools/capture_tool.py show last.cap
+    python tools/capture_tool.py --host 192.168.1.100 --device A1B2C3D4E5F6 replay last.cap --speed 10
+"""
+
+import argparse
+import json
+import queue
+import struct
+import sys
+import time
+
+import paho.mqtt.client as mqtt
+
+RECORD_HEADER = struct.Struct("<IBH")    # deltaUs, topicLen, payloadLen (CAPTURE_RECORD_HEADER_LEN)
+EXPORT_HEADER = struct.Struct("<II")     # offset, Gesamtgröße (CAPTURE_EXPORT_HEADER_LEN)
+DEVICE_PREFIX = "~/"                     # CAPTURE_DEVICE_PREFIX
+STATUS_TIMEOUT = 5.0
+
+
+def parse_records(data):
+    """Zerlegt einen Export in (deltaUs, topic, payload)."""
+    records = []
+    offset = 0
+    while offset + RECORD_HEADER.size <= len(data):
+        delta, topic_len, payload_len = RECORD_HEADER.unpack_from(data, offset)
+        offset += RECORD_HEADER.size
+        end = offset + topic_len + payload_len
+        if topic_len == 0 or end > len(data):
+            print(f"Warnung: unvollständiger Record bei Offset {offset - RECORD_HEADER.size}", file=sys.stderr)
+            break
+        topic = data[offset:offset + topic_len].decode("utf-8", "replace")
+        payload = data[offset + topic_len:end]
+        records.append((delta, topic, payload))
+        offset = end
+    return records
+
+
+def percentile(values, p):
+    if not values:
+        return 0
+    ordered = sorted(values)
+    return ordered[min(len(ordered) - 1, len(ordered) * p // 100)]
+
+
+class DeviceLink:
+    def __init__(self, args):
+        self.base = f"esp32/{args.device}"
+        self.messages = queue.Queue()
+        self.client = mqtt.Client(mqtt.CallbackAPIVersion.VERSION2) if hasattr(mqtt, "CallbackAPIVersion") else mqtt.Client()
+        self.client.username_pw_set(args.username, args.password)
+        self.client.on_message = lambda client, userdata, msg: self.messages.put((msg.topic, msg.payload))
+        self.client.connect(args.host, args.port)
+        self.client.subscribe(f"{self.base}/capture", qos=1)
+        self.client.subscribe(f"{self.base}/capture/data/chunk", qos=1)
+        self.client.subscribe(f"{self.base}/latency", qos=1)
+        self.client.loop_start()
+
+    def close(self):
+        self.client.loop_stop()
+        self.client.disconnect()
+
+    def command(self, cmd, **params):
+        params["cmd"] = cmd
+        self.client.publish(f"{self.base}/capture/cmd", json.dumps(params), qos=1)
+
+    def wait(self, topic_suffix, timeout=STATUS_TIMEOUT):
+        """Wartet auf die nächste Nachricht auf esp32/<id>/<topic_suffix>."""
+        topic = f"{self.base}/{topic_suffix}"
+        deadline = time.time() + timeout
+        while True:
+            remaining = deadline - time.time()
+            if remaining <= 0:
+                return None
+            try:
+                msg_topic, payload = self.messages.get(timeout=remaining)
+            except queue.Empty:
+                return None
+            if msg_topic == topic:
+                return payload
+
+    def status(self, cmd="status", timeout=STATUS_TIMEOUT, **params):
+        self.command(cmd, **params)
+        payload = self.wait("capture", timeout)
+        if payload is None:
+            sys.exit(f"Keine Antwort auf {cmd} (Gerät online?)")
+        status = json.loads(payload)
+        if "error" in status:
+            sys.exit(f"Gerät lehnt {cmd} ab: {status['error']}")
+        return status
+
+
+def print_profile(profile):
+    print(f"Nachrichten: {profile.get('messages')}  minFreeHeap: {profile.get('minFreeHeap')}  "
+          f"largestBlock: {profile.get('largestBlock')}")
+    print(f"{'Handler':<14}{'n':>6}{'mean us':>10}{'p95 us':>10}{'max us':>10}{'arena':>8}{'fallb.':>8}{'heapΔ':>8}")
+    for name, h in profile.get("handlers", {}).items():
+        us = h.get("us", {})
+        print(f"{name:<14}{us.get('n', 0):>6}{us.get('mean', 0):>10}{us.get('p95', 0):>10}{us.get('max', 0):>10}"
+              f"{h.get('arenaMax', 0):>8}{h.get('heapFallbacks', 0):>8}{h.get('heapDelta', 0):>8}")
+
+
+def cmd_export(link, args):
+    link.command("export")
+    chunks = {}
+    total = None
+    received = 0
+    while total is None or received < total:
+        payload = link.wait("capture/data/chunk", timeout=10)
+        if payload is None:
+            sys.exit(f"Export abgebrochen nach {received} Bytes")
+        offset, total = EXPORT_HEADER.unpack_from(payload)
+        data = payload[EXPORT_HEADER.size:]
+        if offset not in chunks:
+            chunks[offset] = data
+            received += len(data)
+        if not data:
+            break
+        print(f"\r{received}/{total} Bytes", end="")
+    print()
+
+    data = b"".join(chunks[o] for o in sorted(chunks))
+    with open(args.output, "wb") as f:
+        f.write(data)
+    print(f"{len(parse_records(data))} Records in {args.output} gespeichert")
+
+
+def cmd_show(args):
+    with open(args.file, "rb") as f:
+        records = parse_records(f.read())
+    if not records:
+        print("Keine Records")
+        return
+
+    duration = sum(r[0] for r in records[1:]) / 1e6
+    print(f"{len(records)} Records über {duration:.1f} s")
+    by_topic = {}
+    for delta, topic, payload in records:
+        entry = by_topic.setdefault(topic, [0, 0])
+        entry[0] += 1
+        entry[1] += len(payload)
+    for topic, (count, size) in sorted(by_topic.items(), key=lambda item: -item[1][0]):
+        print(f"  {count:>6} x {topic:<40} {size // count:>6} Bytes im Mittel")
+    gaps = [r[0] for r in records[1:]]
+    if gaps:
+        print(f"Abstand: p50 {percentile(gaps, 50)} us, p95 {percentile(gaps, 95)} us, min {min(gaps)} us")
+
+    if args.verbose:
+        t = 0
+        for delta, topic, payload in records:
+            t += delta
+            print(f"{t / 1e6:10.3f}  {topic}  {payload[:120]!r}")
+
+
+def cmd_replay(link, args):
+    if args.on_device:
+        status = link.status("replay", speed=args.speed, settings=args.settings)
+        print(f"Wiedergabe auf dem Gerät gestartet ({status['replay']['total']} Bytes)")
+        payload = link.wait("capture", timeout=args.timeout)
+        while payload is not None and json.loads(payload)["replay"]["active"]:
+            payload = link.wait("capture", timeout=args.timeout)
+        if payload is None:
+            sys.exit("Kein Abschluss der Wiedergabe gemeldet")
+        status = json.loads(payload)
+        replay = status["replay"]
+        print(f"{replay['replayed']} Nachrichten in {replay['durationMs']} ms "
+              f"({replay['skipped']} übersprungen)")
+        print_profile(status.get("profile", {}))
+        return
+
+    with open(args.file, "rb") as f:
+        records = parse_records(f.read())
+    target = args.target or args.device
+
+    link.status("profile", reset=True)   # Profil ab jetzt nur für die Wiedergabe
+    lag = []
+    sent = 0
+    start = time.perf_counter()
+    due = 0.0
+    for index, (delta, topic, payload) in enumerate(records):
+        if topic.startswith(DEVICE_PREFIX):
+            topic = f"esp32/{target}/{topic[len(DEVICE_PREFIX):]}"
+        if topic.endswith("/settings/set") and not args.settings:
+            continue
+        if index > 0 and args.speed > 0:
+            due += delta / 1e6 / args.speed
+        now = time.perf_counter() - start
+        if due > now:
+            time.sleep(due - now)
+        lag.append((time.perf_counter() - start - due) * 1e6)
+        link.client.publish(topic, payload, qos=args.qos)
+        sent += 1
+
+    elapsed = time.perf_counter() - start
+    print(f"{sent} Nachrichten in {elapsed:.2f} s gesendet "
+          f"(Sende-Verzug p50 {percentile(lag, 50):.0f} us, p95 {percentile(lag, 95):.0f} us)")
+
+    time.sleep(args.settle)
+    status = link.status("profile")
+    print_profile(status.get("profile", {}))
+
+    link.client.publish(f"{link.base}/latency/get", "", qos=1)
+    latency = link.wait("latency")
+    if latency is not None:
+        print("Latenz:", json.dumps(json.loads(latency), indent=2))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="MQTT-Verkehr aufzeichnen und wiedergeben")
+    parser.add_argument("--device", help="Geräte-ID (MAC ohne Trennzeichen)")
+    parser.add_argument("--host", help="MQTT-Broker")
+    parser.add_argument("--port", type=int, default=1883)
+    parser.add_argument("--username", default="guest")
+    parser.add_argument("--password", default="guest")
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    sub.add_parser("start", help="Aufzeichnung neu beginnen")
+    sub.add_parser("stop", help="Aufzeichnung beenden")
+    sub.add_parser("status", help="Zustand der Aufzeichnung")
+    profile = sub.add_parser("profile", help="Handler-Profil des Geräts ausgeben")
+    profile.add_argument("--reset", action="store_true", help="Profil danach zurücksetzen")
+
+    export = sub.add_parser("export", help="Aufzeichnung vom Gerät laden")
+    export.add_argument("-o", "--output", required=True)
+
+    show = sub.add_parser("show", help="Aufzeichnung auswerten (ohne Broker)")
+    show.add_argument("file")
+    show.add_argument("-v", "--verbose", action="store_true", help="Alle Records ausgeben")
+
+    replay = sub.add_parser("replay", help="Aufzeichnung abspielen")
+    replay.add_argument("file", nargs="?", help="Export-Datei (nicht nötig mit --on-device)")
+    replay.add_argument("--speed", type=float, default=1.0, help="Zeitfaktor, 0 = ohne Pausen")
+    replay.add_argument("--target", help="Ziel-Gerät für ~/-Topics (Standard: --device)")
+    replay.add_argument("--qos", type=int, default=1, choices=(0, 1))
+    replay.add_argument("--settings", action="store_true", help="settings/set mit abspielen")
+    replay.add_argument("--settle", type=float, default=2.0, help="Wartezeit vor dem Abruf des Profils (s)")
+    replay.add_argument("--timeout", type=float, default=600.0, help="Max. Dauer der Wiedergabe auf dem Gerät (s)")
+    replay.add_argument("--on-device", action="store_true", help="Gerät spielt die eigene Aufzeichnung ab")
+    args = parser.parse_args()
+
+    if args.command == "show":
+        cmd_show(args)
+        return
+    if not args.host or not args.device:
+        parser.error("--host und --device sind erforderlich")
+    if args.command == "replay" and not args.on_device and not args.file:
+        parser.error("replay benötigt eine Export-Datei oder --on-device")
+
+    link = DeviceLink(args)
+    try:
+        if args.command == "export":
+            cmd_export(link, args)
+        elif args.command == "replay":
+            cmd_replay(link, args)
+        elif args.command == "profile":
+            print_profile(link.status("profile", reset=args.reset).get("profile", {}))
+        else:
+            print(json.dumps(link.status(args.command), indent=2))
+    finally:
+        link.close()
+
+
+if __name__ == "__main__":
+    main()
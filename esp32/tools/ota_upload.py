@@ -0,0 +1,141 @@
+#!/usr/bin/env python3
+"""
+OTA-Upload über MQTT für die ESP32-Firmware.
+
+Sendet ein Firmware-Image (z.B. .pio/build/nodemcu-32s/firmware.bin) in Chunks an
+esp32/<deviceId>/ota/chunk. Der ESP32 quittiert alle 8 Chunks (OTA_STATUS_EVERY)
+sowie beim ersten verworfenen Chunk auf ota/status mit dem nächsten erwarteten
+Offset; es sind maximal WINDOW Chunks gleichzeitig unterwegs. Ein unterbrochenes
+Update wird beim nächsten Aufruf mit demselben Image automatisch fortgesetzt.
+
+ota/begin enthält eine HMAC-SHA256 über den SHA-256 des Images mit dem
+gemeinsamen Secret (OTA_SHARED_SECRET in secrets.h, hier --secret oder die
+Umgebungsvariable OTA_SECRET).
+
+Beispiel:
+    pip install paho-mqtt
+    python tools/ota_upload.py --host 192.168.1.100 --device A1B2C3D4E5F6 --secret <Secret> \
+        .pio/build/nodemcu-32s/firmware.bin
+"""
+
+import argparse
+import hashlib
+import hmac
+import json
+import os
+import struct
+import sys
+import threading
+import time
+import zlib
+
+import paho.mqtt.client as mqtt
+
+CHUNK_SIZE = 1536      # Muss <= OTA_CHUNK_MAX in ota_update.h sein
+WINDOW = 16            # Chunks "in flight" (2 x OTA_STATUS_EVERY, TCP bremst bei vollen Puffern)
+ACK_TIMEOUT = 5.0      # Sekunden ohne Quittung -> ab letztem Offset neu senden
+
+
+class OtaUploader:
+    def __init__(self, client, device_id, image, secret):
+        self.client = client
+        self.base = f"esp32/{device_id}/ota"
+        self.image = image
+        self.sha256 = hashlib.sha256(image).hexdigest()
+        self.hmac = hmac.new(secret.encode(), self.sha256.encode(), hashlib.sha256).hexdigest()
+        self.status = {}
+        self.acked = 0           # Vom Gerät bestätigter Offset
+        self.event = threading.Event()
+
+    def on_message(self, client, userdata, msg):
+        try:
+            self.status = json.loads(msg.payload)
+        except ValueError:
+            return
+        self.acked = self.status.get("offset", self.acked)
+        self.event.set()
+
+    def wait_status(self, timeout):
+        self.event.clear()
+        return self.event.wait(timeout)
+
+    def begin(self):
+        payload = json.dumps({"size": len(self.image), "sha256": self.sha256, "hmac": self.hmac})
+        while True:
+            self.client.publish(f"{self.base}/begin", payload, qos=1)
+            if self.wait_status(ACK_TIMEOUT) and self.status.get("state") == "receiving":
+                return
+            if self.status.get("state") == "error":
+                sys.exit(f"Gerät lehnt Update ab: {self.status.get('error')}")
+
+    def send_chunk(self, offset):
+        data = self.image[offset:offset + CHUNK_SIZE]
+        header = struct.pack("<II", offset, zlib.crc32(data) & 0xFFFFFFFF)
+        self.client.publish(f"{self.base}/chunk", header + data, qos=0)
+        return offset + len(data)
+
+    def run(self):
+        self.begin()
+        start = time.time()
+        sent = self.acked
+        print(f"Starte bei Offset {sent} von {len(self.image)} Bytes")
+
+        while self.status.get("state") == "receiving" and self.acked < len(self.image):
+            # Fenster auffüllen
+            while sent < len(self.image) and sent - self.acked < WINDOW * CHUNK_SIZE:
+                sent = self.send_chunk(sent)
+
+            previous = self.acked
+            if not self.wait_status(ACK_TIMEOUT):
+                # Keine Quittung (z.B. Verbindungsabbruch): Sitzung fortsetzen
+                print("Timeout, setze fort...")
+                self.begin()
+                sent = self.acked
+            elif self.acked == previous or self.acked > sent:
+                # Kein Fortschritt: Gerät hat einen Chunk verworfen -> ab dem erwarteten Offset neu senden
+                sent = self.acked
+            print(f"\r{self.acked * 100 // len(self.image):3d} % ({self.acked} Bytes)", end="")
+
+        print()
+        # Auf Prüfung und Abschluss warten
+        while self.status.get("state") in ("receiving", "verifying"):
+            if not self.wait_status(30):
+                break
+
+        elapsed = time.time() - start
+        print(f"Status: {self.status} nach {elapsed:.1f} s")
+        return self.status.get("state") == "done"
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Firmware-Update über MQTT")
+    parser.add_argument("image", help="Pfad zur firmware.bin")
+    parser.add_argument("--device", required=True, help="Geräte-ID (MAC ohne Trennzeichen)")
+    parser.add_argument("--host", required=True, help="MQTT-Broker")
+    parser.add_argument("--port", type=int, default=1883)
+    parser.add_argument("--username", default="guest")
+    parser.add_argument("--password", default="guest")
+    parser.add_argument("--secret", default=os.environ.get("OTA_SECRET"),
+                        help="OTA_SHARED_SECRET des Geräts (Standard: $OTA_SECRET)")
+    args = parser.parse_args()
+    if not args.secret:
+        parser.error("--secret oder OTA_SECRET ist erforderlich")
+
+    with open(args.image, "rb") as f:
+        image = f.read()
+
+    client = mqtt.Client(mqtt.CallbackAPIVersion.VERSION2) if hasattr(mqtt, "CallbackAPIVersion") else mqtt.Client()
+    client.username_pw_set(args.username, args.password)
+    uploader = OtaUploader(client, args.device, image, args.secret)
+    client.on_message = uploader.on_message
+    client.connect(args.host, args.port)
+    client.subscribe(f"{uploader.base}/status", qos=1)
+    client.loop_start()
+
+    ok = uploader.run()
+    client.loop_stop()
+    sys.exit(0 if ok else 1)
+
+
+if __name__ == "__main__":
+    main()
@@ -26,6 +26,13 @@ export interface ExtendedGPIO extends GPIO {
 
 export type SetGPIO = Pick<GPIO, "pinNumber" | "state">;
 
+// gpio/set mit Korrelations-ID: Das Gerät erkennt damit vom Broker
+// wiederholte Zustellungen (QoS 1) und schaltet sie nicht erneut
+export interface SetGPIOCommand {
+  cid: string;
+  gpios: SetGPIO[];
+}
+
 export interface Device {
   id: string;
   name: string;